@@ -28,9 +28,20 @@
 #include "NFCReader.h"
 
 // ========== CONFIGURATION ==========
-// Choose communication mode: I2C or SPI
+// Choose communication mode: I2C, SPI or HSU
 #define USE_SPI  // Comment this out and uncomment USE_I2C to use I2C mode
 // #define USE_I2C
+// #define USE_HSU  // UART on Serial1 (Mega, Leonardo); Serial is the console
+
+// SPI clock for the hardware SPI peripheral (pins 11-13, PN532 max 5 MHz);
+// 0 bit-bangs the SPI pins instead
+#define SPI_CLOCK 4000000UL
+
+// I2C clock: 400 kHz fast mode, or 100 kHz for long wires
+#define I2C_CLOCK 400000UL
+
+// HSU baud rate: the PN532 starts at 115200 and is switched to this rate
+#define HSU_BAUD 115200UL
 
 // Choose reading mode: POLLING or IRQ
 #define USE_IRQ_MODE  // Comment out for polling mode
@@ -42,6 +53,12 @@
   #else
     NFCReader nfcReader(NFCCommMode::I2C, NFCReadMode::POLLING);
   #endif
+#elif defined(USE_HSU)
+  #ifdef USE_IRQ_MODE
+    NFCReader nfcReader(NFCCommMode::HSU, NFCReadMode::IRQ);
+  #else
+    NFCReader nfcReader(NFCCommMode::HSU, NFCReadMode::POLLING);
+  #endif
 #elif defined(USE_SPI)
   #ifdef USE_IRQ_MODE
     NFCReader nfcReader(NFCCommMode::SPI, NFCReadMode::IRQ);
@@ -49,7 +66,7 @@
     NFCReader nfcReader(NFCCommMode::SPI, NFCReadMode::POLLING);
   #endif
 #else
-  #error "Please define either USE_I2C or USE_SPI"
+  #error "Please define USE_I2C, USE_SPI or USE_HSU"
 #endif
 
 // ========== HELPER FUNCTIONS ==========
@@ -72,6 +89,9 @@ void printCardType(NFCCardType cardType) {
     case NFCCardType::NTAG:
       Serial.println(F("NTAG (213/215/216)"));
       break;
+    case NFCCardType::ISO14443_4:
+      Serial.println(F("ISO 14443-4 (DESFire, phone)"));
+      break;
     default:
       Serial.println(F("Unknown"));
       break;
@@ -129,6 +149,13 @@ void setup() {
   
   // Initialize NFC reader
   Serial.println(F("Initializing NFC reader..."));
+  #if defined(USE_HSU)
+    nfcReader.setHSUBaud(HSU_BAUD);
+  #elif defined(USE_SPI)
+    nfcReader.setSPIClock(SPI_CLOCK);
+  #else
+    nfcReader.setI2CClock(I2C_CLOCK);
+  #endif
   if (!nfcReader.begin()) {
     Serial.println(F("❌ Failed to initialize NFC reader!"));
     Serial.println(F("Please check:"));
@@ -4,14 +4,12 @@
 #include <Arduino.h>
 #include <LiquidCrystal.h>
 
-// Suppress unused variable warning from EEPROM library
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-#include <EEPROM.h>
-#pragma GCC diagnostic pop
-
 #include "Config.h"
 #include "NFCReader.h"
+#include "NFCReaderGroup.h"
+#include "CardStore.h"
+#include "LCDBuffer.h"
+#include "LoopProfiler.h"
 
 // System states
 enum class SystemState {
@@ -23,7 +21,8 @@ enum class SystemState {
   DELETING,       // Deleting card
   LISTING_CARDS,  // Displaying stored cards
   CLONING_SOURCE, // Waiting for source card to clone
-  CLONING_TARGET  // Waiting for target card to write
+  CLONING_TARGET, // Waiting for target card to write
+  SHOWING_MESSAGE // Timed message, then _messageNextState
 };
 
 // Menu items
@@ -38,18 +37,13 @@ enum class MenuItem {
   MENU_COUNT  // Total number of menu items
 };
 
-// Stored card structure
-struct StoredCard {
-  uint8_t uid[MAX_UID_LENGTH];
-  uint8_t uidLength;
-  bool active;  // For soft delete
-};
-
 class AccessControlSystem {
 public:
   AccessControlSystem(NFCReader& nfcReader);
   
-  // Initialization
+  // Initialization. Further readers (e.g. the exit side) are added before
+  // begin() and take turns with the first one; any of them unlocks the door.
+  bool addReader(NFCReader& reader) { return _readers.add(reader); }
   bool begin();
   
   // Main loop - call this repeatedly
@@ -61,6 +55,8 @@ public:
   bool deleteCard(const NFCCardInfo& cardInfo);
   void clearAllCards();
   uint8_t getStoredCardCount();
+  const CardFilterStats& getFilterStats() const { return _cards.filterStats(); }
+  const LCDBuffer& getDisplay() const { return _display; }
   
   // System control
   void grantAccess();
@@ -68,8 +64,9 @@ public:
   void unlockDoor();
   
 private:
-  NFCReader& _nfc;
+  NFCReaderGroup _readers;
   LiquidCrystal _lcd;
+  LCDBuffer _display;
   
   SystemState _currentState;
   SystemState _lastDisplayState;
@@ -84,9 +81,8 @@ private:
   bool _relayActive;
   bool _displayNeedsUpdate;
   
-  // EEPROM cache
-  uint8_t _cachedCardCount;
-  bool _cardCountCacheValid;
+  // Card database
+  CardStore _cards;
   
   // List cards state
   uint8_t _listCardIndex;
@@ -115,6 +111,10 @@ private:
   // Clone operation
   NFCCardInfo _cloneSourceCard;
   
+  // Timed message state
+  unsigned long _messageDuration;
+  SystemState _messageNextState;
+  
   // Initialization
   void initEEPROM();
   void initButtons();
@@ -130,6 +130,7 @@ private:
   void displayDeleting();
   void displayCloning();
   void displayMessage(const char* line1, const char* line2);
+  void showTimedMessage(const char* line1, const char* line2, unsigned long duration, SystemState nextState);
   void clearDisplay();
   
   // Button handling
@@ -155,18 +156,8 @@ private:
   void setState(SystemState newState);
   void checkStateTimeout();
   
-  // EEPROM operations
-  void saveCardToEEPROM(const StoredCard& card, uint8_t index);
-  bool loadCardFromEEPROM(StoredCard& card, uint8_t index);
-  void saveCardCount(uint8_t count);
-  uint8_t loadCardCount();
-  int findCardInEEPROM(const NFCCardInfo& cardInfo);
-  
   // Relay control
   void updateRelay();
-  
-  // Card comparison
-  bool compareUIDs(const uint8_t* uid1, const uint8_t* uid2, uint8_t length);
 };
 
 #endif // ACCESS_CONTROL_SYSTEM_H
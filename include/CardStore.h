@@ -0,0 +1,153 @@
+#ifndef CARD_STORE_H
+#define CARD_STORE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "EEPROMWriteQueue.h"
+
+// Stored card structure
+struct StoredCard {
+  uint8_t uid[MAX_UID_LENGTH];
+  uint8_t uidLength;
+  bool active;  // Cleared = tombstone
+};
+
+// Packed EEPROM card record: [header][UID bytes]
+// Header high nibble = UID length (4 or 7), low nibble = flags
+namespace CardLayout {
+  constexpr uint8_t FLAG_ACTIVE = 0x01;
+  constexpr uint8_t HEADER_SIZE = 1;
+  constexpr uint8_t WRAP_MARKER = 0x00;  // Rest of the log area is unused, continue at LOG_START
+  
+  constexpr uint8_t header(uint8_t uidLength, bool active) {
+    return (uint8_t)((uidLength << 4) | (active ? FLAG_ACTIVE : 0));
+  }
+  constexpr uint8_t uidLength(uint8_t header) { return header >> 4; }
+  constexpr bool isActive(uint8_t header) { return (header & FLAG_ACTIVE) != 0; }
+  constexpr bool isValidLength(uint8_t uidLength) { return uidLength == 4 || uidLength == 7; }
+  constexpr bool isValid(uint8_t header) { return isValidLength(uidLength(header)); }
+  constexpr uint8_t recordSize(uint8_t uidLength) { return HEADER_SIZE + uidLength; }
+  constexpr uint8_t MAX_RECORD_SIZE = HEADER_SIZE + MAX_UID_LENGTH;
+  
+  // EEPROM map: [magic][reserved][record log ...][journal]
+  // Journal entry: [head hi][head lo][tail hi][tail lo][sequence], sequence written last
+  constexpr uint16_t END = (uint16_t)E2END + 1;
+  constexpr uint8_t JOURNAL_ENTRY_SIZE = 5;
+  constexpr uint16_t JOURNAL_START = END - CARD_JOURNAL_ENTRIES * JOURNAL_ENTRY_SIZE;
+  constexpr uint16_t LOG_START = EEPROM_CARDS_START;
+  constexpr uint16_t LOG_END = JOURNAL_START;
+  constexpr uint16_t LOG_SIZE = LOG_END - LOG_START;
+  
+  // Free space kept back from appends so compaction can always move a record
+  constexpr uint8_t COMPACT_RESERVE = 3 * MAX_RECORD_SIZE;
+  
+  // Index entries pack an EEPROM address and a truncated fingerprint into 32 bits
+  constexpr uint8_t bitsFor(uint32_t n) { return n ? 1 + bitsFor(n >> 1) : 0; }
+  constexpr uint8_t ADDR_BITS = bitsFor(E2END);
+  constexpr uint8_t FINGERPRINT_BITS = 32 - ADDR_BITS;
+  
+  // Legacy (pre-packed) format: [length][active][uid x 7], at most 40 records
+  constexpr uint8_t LEGACY_RECORD_SIZE = MAX_UID_LENGTH + 2;
+  constexpr uint8_t LEGACY_MAX_CARDS = 40;
+  constexpr uint16_t LEGACY_END = LOG_START + LEGACY_MAX_CARDS * LEGACY_RECORD_SIZE;
+}
+
+static_assert(MAX_STORED_CARDS * CardLayout::MAX_RECORD_SIZE + CardLayout::COMPACT_RESERVE < CardLayout::LOG_SIZE,
+              "MAX_STORED_CARDS exceeds EEPROM capacity");
+static_assert(CardLayout::LEGACY_END + CardLayout::LEGACY_MAX_CARDS * CardLayout::MAX_RECORD_SIZE < CardLayout::LOG_END,
+              "Legacy migration needs room for the repacked records past the old table");
+static_assert(MAX_STORED_CARDS <= 255, "Card count is held in one byte");
+static_assert((CARD_BLOOM_BITS & (CARD_BLOOM_BITS - 1)) == 0, "CARD_BLOOM_BITS must be a power of two");
+
+// RAM index entry: UID fingerprint -> EEPROM record address
+// Kept sorted by fingerprint so lookups are a binary search
+struct CardIndexEntry {
+  uint32_t fingerprint : CardLayout::FINGERPRINT_BITS;
+  uint32_t addr : CardLayout::ADDR_BITS;
+};
+
+// Bloom filter counters, used to size CARD_BLOOM_BITS
+struct CardFilterStats {
+  uint32_t lookups;         // Card lookups that went through the filter
+  uint32_t rejects;         // Answered "not registered" by the filter alone
+  uint32_t falsePositives;  // Filter said "maybe" but the card was not registered
+};
+
+// Authorized card database in EEPROM.
+//
+// Records are appended to a ring log between LOG_START and the journal.
+// Deleting a card clears the active bit in its header (one byte), and the
+// space is reclaimed later by compaction, which re-appends live records
+// from the head and moves the head past them. The live region [head, tail)
+// is recorded in a rotating journal; an append or compaction step only
+// becomes visible once its journal entry's sequence byte is written, so a
+// reset part-way through leaves the previous state intact.
+class CardStore {
+public:
+  CardStore();
+  
+  // Load (formatting or migrating older layouts) and build the RAM index
+  void begin();
+  
+  // Card management
+  bool contains(const uint8_t* uid, uint8_t length);
+  bool add(const uint8_t* uid, uint8_t length);  // false if present, full or not a 4/7-byte UID
+  bool remove(const uint8_t* uid, uint8_t length);
+  void clear();
+  uint8_t count() const { return _count; }
+  bool cardAt(uint8_t position, StoredCard& card);  // Oldest first
+  
+  // Background compaction, one step per call
+  bool needsCompaction() const;
+  bool compactStep();
+  
+  // Diagnostics
+  uint16_t freeBytes() const;
+  uint16_t garbageBytes() const { return _garbageBytes; }
+  const CardFilterStats& filterStats() const { return _filterStats; }
+  
+private:
+  uint16_t _head;          // Oldest record that may still be live
+  uint16_t _tail;          // Where the next record goes
+  uint16_t _garbageBytes;  // Tombstones and wrap padding inside [head, tail)
+  uint8_t _journalSlot;    // Journal entry holding the current head/tail
+  uint8_t _journalSeq;
+  uint8_t _count;
+  
+  // RAM-resident UID index (4 bytes per card)
+  CardIndexEntry _index[MAX_STORED_CARDS];
+  uint8_t _indexCount;
+  
+  // Bloom filter over registered UID fingerprints
+  uint8_t _bloom[CARD_BLOOM_BITS / 8];
+  CardFilterStats _filterStats;
+  
+  // Layout setup
+  void format(uint16_t head, uint16_t tail);
+  void migrateLegacy();
+  uint16_t packedTableEnd();
+  bool loadJournal();
+  void scanLog();
+  
+  // Log operations
+  void commit(uint16_t head, uint16_t tail);
+  uint16_t advance(uint16_t addr, uint8_t size) const;
+  uint16_t append(const StoredCard& card, uint16_t head);
+  int find(const uint8_t* uid, uint8_t length);
+  void writeRecord(const StoredCard& card, uint16_t addr);
+  bool readRecord(StoredCard& card, uint16_t addr);
+  
+  // Card index
+  uint32_t fingerprintUID(const uint8_t* uid, uint8_t length);
+  uint8_t findIndexPosition(uint32_t fingerprint);
+  void indexInsert(uint32_t fingerprint, uint16_t addr);
+  void indexRemove(uint16_t addr);
+  void indexMove(uint32_t fingerprint, uint16_t from, uint16_t to);
+  
+  // Bloom filter
+  void bloomAdd(uint32_t fingerprint);
+  bool bloomMayContain(uint32_t fingerprint);
+  void rebuildBloom();
+};
+
+#endif // CARD_STORE_H
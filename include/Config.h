@@ -12,6 +12,15 @@
 #define NFC_SS    10
 #define NFC_IRQ   2
 #define NFC_RST   3
+#define NFC_SPI_CLOCK 4000000UL  // Hardware SPI on pins 11-13 (PN532 max 5 MHz), 0 = bit-banged
+#define NFC_I2C_CLOCK 400000UL   // I2C mode (PN532 max 400 kHz)
+#define NFC_HSU_BAUD  115200UL   // HSU mode, on Serial1 (boards with a second UART only)
+
+// Optional second (exit) reader: SPI on the same bus with its own SS, and
+// the other external interrupt pin for IRQ (NFC_RST is only used by I2C)
+// #define NFC_EXIT_READER
+#define NFC_EXIT_SS   A4
+#define NFC_EXIT_IRQ  3
 
 // LCD Pins (4-bit Parallel Mode)
 #define LCD_RS    4
@@ -35,11 +44,35 @@
 // LCD Configuration
 #define LCD_COLS   16
 #define LCD_ROWS   2
+#define LCD_FLUSH_BUDGET_US  1000  // LCD bus time per update(); a character takes ~270 us
+
+// Loop timing: build with -DLOOP_PROFILING, then send 'p' over Serial for
+// a report or 'r' to clear it (see LoopProfiler.h)
+
+// Tap tracing: build with -DTAP_TRACING; each tap is logged on Serial and
+// 't' prints the tap-to-unlock summary (see TapTracer.h)
+#define TAP_TRACE_EVENTS   32   // Ring of trace points, 5 bytes each
+#define TAP_TRACE_HISTORY  16   // Taps kept for p50/p95/max
 
 // Access Control Settings
 #define RELAY_ACTIVE_HIGH  true   // true = relay ON when pin HIGH, false = active LOW
 #define DOOR_UNLOCK_TIME   3000   // milliseconds
-#define MAX_STORED_CARDS   40     // Maximum number of cards to store in EEPROM
+#define MAX_STORED_CARDS   100    // Limited by the RAM index (4 bytes/card)
+#define FAST_GRANT_PHYSICAL_UID  true  // Grant on a registered physical UID without reading
+                                       // the custom sector; false = a cloned UID always wins
+
+// Bloom filter for rejecting unknown cards without touching EEPROM.
+// At least 10 bits per card, rounded up to a power of two: with 3 hashes
+// that keeps false positives at 1-2% when the store is full (1024 bits,
+// 128 bytes RAM, at 100 cards)
+#define CARD_BLOOM_BITS    (MAX_STORED_CARDS <= 25 ? 256 : MAX_STORED_CARDS <= 51 ? 512 : \
+                            MAX_STORED_CARDS <= 102 ? 1024 : 2048)
+#define CARD_BLOOM_HASHES  3
+
+// Card log (see CardStore.h)
+#define CARD_JOURNAL_ENTRIES     16   // Rotating head/tail journal slots, 5 bytes each
+#define CARD_COMPACT_FREE_BYTES  128  // Compact in the background below this much free log space
+#define EEPROM_WRITE_QUEUE_SIZE  16   // Pending EEPROM byte writes (3 bytes RAM each)
 
 // Button Settings
 #define BUTTON_DEBOUNCE_TIME  20   // milliseconds
@@ -47,9 +80,11 @@
 
 // EEPROM Addresses
 #define EEPROM_MAGIC_ADDR      0    // Magic number to check if EEPROM is initialized
-#define EEPROM_CARD_COUNT_ADDR 2    // Number of stored cards
+#define EEPROM_CARD_COUNT_ADDR 2    // Number of stored cards (older layouts only)
 #define EEPROM_CARDS_START     4    // Start of card storage area
-#define EEPROM_MAGIC_NUMBER    0xABCD  // Magic number value
+#define EEPROM_MAGIC_NUMBER    0xABCF  // Magic number value (record log)
+#define EEPROM_PACKED_MAGIC    0xABCE  // Packed table with count byte, converted on boot
+#define EEPROM_LEGACY_MAGIC    0xABCD  // Fixed 9-byte records, converted on boot
 
 // Card UID Settings
 #define MAX_UID_LENGTH     7    // Maximum UID length (Mifare Classic = 4, Ultralight = 7)
@@ -57,11 +92,13 @@
 // NFC Communication Mode Shortcuts
 #define NFC_COMM_I2C  NFCCommMode::I2C
 #define NFC_COMM_SPI  NFCCommMode::SPI
+#define NFC_COMM_HSU  NFCCommMode::HSU
 #define NFC_READ_POLLING  NFCReadMode::POLLING
 #define NFC_READ_IRQ      NFCReadMode::IRQ
 
 // Display Timeouts
 #define MESSAGE_DISPLAY_TIME  2000  // How long to show access granted/denied messages (gives time to remove card)
 #define MENU_TIMEOUT          30000 // Return to main screen if no activity (30 seconds)
+#define CLONE_MESSAGE_TIME    2000  // How long to show clone results before returning to idle
 
 #endif // CONFIG_H
@@ -0,0 +1,58 @@
+#ifndef EEPROM_WRITE_QUEUE_H
+#define EEPROM_WRITE_QUEUE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Byte writes to the internal EEPROM, programmed in the background.
+//
+// A write takes ~3.3 ms per byte on the ATmega328P, and EEPROM.write()
+// spins until the previous one has finished. Writes queued here are
+// started one at a time from the EE_READY interrupt instead, so the
+// caller only blocks when the queue is full. Writes complete in the
+// order they were queued, and read() returns queued values, so callers
+// see the same contents as if every write had already finished.
+class EEPROMWriteQueue {
+public:
+  EEPROMWriteQueue();
+
+  // Queue a write; skipped if the byte already holds (or will hold) the value
+  void write(uint16_t addr, uint8_t value);
+  uint8_t read(uint16_t addr);
+
+  // Completion
+  uint16_t ticket() const { return _queued; }  // Covers every write queued so far
+  bool isComplete(uint16_t ticket);
+  bool idle() const { return _count == 0; }
+  void flush();  // Wait until every queued write has been programmed
+
+  // Statistics
+  uint32_t writesQueued() const { return _totalQueued; }
+  uint32_t writesSkipped() const { return _totalSkipped; }
+
+  // EE_READY interrupt body
+  void handleReady();
+
+private:
+  struct Entry {
+    uint16_t addr;
+    uint8_t value;
+  };
+
+  volatile Entry _entries[EEPROM_WRITE_QUEUE_SIZE];
+  volatile uint8_t _first;      // Oldest entry; being programmed if _inFlight
+  volatile uint8_t _count;
+  volatile bool _inFlight;
+  volatile uint16_t _completed; // Writes programmed, wraps with _queued
+  uint16_t _queued;
+  uint32_t _totalQueued;
+  uint32_t _totalSkipped;
+
+  void suspend();
+  void resume();
+  uint8_t readPending(uint16_t addr, bool& found);
+};
+
+extern EEPROMWriteQueue EEPROMQueue;
+
+#endif // EEPROM_WRITE_QUEUE_H
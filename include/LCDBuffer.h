@@ -0,0 +1,56 @@
+#ifndef LCD_BUFFER_H
+#define LCD_BUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+#include "Config.h"
+
+// Shadow framebuffer in front of the HD44780.
+//
+// Display code clears, positions and prints into RAM exactly as it would
+// on the LCD. flush() compares the buffer with what is on the glass and
+// sends only the changed cells, with a setCursor() in front of each run,
+// so redrawing an unchanged screen costs nothing and the 2 ms clear()
+// is never sent after begin(). With a time budget, a large redraw is
+// spread over several loop iterations.
+class LCDBuffer : public Print {
+public:
+  LCDBuffer(LiquidCrystal& lcd);
+
+  void begin();
+
+  // Same drawing calls as LiquidCrystal; text past column 16 is dropped
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  size_t write(uint8_t value) override;
+  using Print::write;
+
+  // Send changed cells to the LCD, stopping once budgetMicros have
+  // been spent (0 = send everything); the rest goes on the next call
+  void flush(uint16_t budgetMicros = 0);
+  bool pending() const { return _dirty; }
+
+  // Bytes sent to the LCD (commands and characters)
+  uint32_t bytesPushed() const { return _bytesPushed; }
+  uint16_t bytesPerSecond() const { return _bytesPerSecond; }  // Over the last second
+
+private:
+  LiquidCrystal& _lcd;
+
+  char _shadow[LCD_ROWS][LCD_COLS];  // What the display code drew
+  char _glass[LCD_ROWS][LCD_COLS];   // What the LCD shows
+  uint8_t _col;
+  uint8_t _row;
+  uint8_t _lcdCol;  // Where the LCD's own cursor is
+  uint8_t _lcdRow;
+  bool _dirty;      // Some cells differ from the glass
+
+  uint32_t _bytesPushed;
+  uint32_t _windowStartBytes;
+  uint16_t _bytesPerSecond;
+  unsigned long _windowStart;
+
+  void updateRate();
+};
+
+#endif // LCD_BUFFER_H
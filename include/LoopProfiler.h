@@ -0,0 +1,66 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Phases of AccessControlSystem::update()
+enum class LoopPhase : uint8_t {
+  BUTTONS,
+  RELAY,
+  TIMEOUTS,
+  NFC,
+  STATE,
+  COMPACTION,
+  DISPLAY,
+  TOTAL,       // Whole update() call
+  COUNT
+};
+
+#ifdef LOOP_PROFILING
+
+// micros()-based timing of each loop phase: min/max/mean and a log2
+// histogram (bin i counts durations of 2^i to 2^(i+1)-1 us, bin 0 also
+// takes 0 us and the last bin everything longer). About 420 bytes of
+// RAM, so only built with -DLOOP_PROFILING.
+class LoopProfiler {
+public:
+  static const uint8_t HISTOGRAM_BINS = 16;
+
+  LoopProfiler();
+
+  // Adds micros() - since to the phase; returns micros() for the next one
+  unsigned long record(LoopPhase phase, unsigned long since);
+
+  void reset();
+  void print();  // Report on Serial
+
+private:
+  struct PhaseStats {
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint64_t totalMicros;  // 32 bits would wrap after 71 minutes
+    uint32_t count;
+    uint16_t histogram[HISTOGRAM_BINS];  // Saturates at 65535
+  };
+
+  PhaseStats _phases[(uint8_t)LoopPhase::COUNT];
+};
+
+extern LoopProfiler LoopProfile;
+
+#define LOOP_PROFILE_START() \
+  unsigned long loopStart_ = micros(); \
+  unsigned long phaseStart_ = loopStart_
+#define LOOP_PROFILE_PHASE(phase) phaseStart_ = LoopProfile.record(phase, phaseStart_)
+#define LOOP_PROFILE_END() LoopProfile.record(LoopPhase::TOTAL, loopStart_)
+
+#else
+
+#define LOOP_PROFILE_START()
+#define LOOP_PROFILE_PHASE(phase)
+#define LOOP_PROFILE_END()
+
+#endif // LOOP_PROFILING
+
+#endif // LOOP_PROFILER_H
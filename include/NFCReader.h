@@ -2,12 +2,14 @@
 #define NFC_READER_H
 
 #include <Arduino.h>
-#include <Adafruit_PN532.h>
+#include "PN532.h"
+#include "TapTracer.h"
 
 // Communication mode enum
 enum class NFCCommMode {
   I2C,
-  SPI
+  SPI,
+  HSU   // UART, see setHSUPort()
 };
 
 // Reading mode enum
@@ -22,7 +24,8 @@ enum class NFCCardType {
   MIFARE_CLASSIC_1K,
   MIFARE_CLASSIC_4K,
   MIFARE_ULTRALIGHT,
-  NTAG
+  NTAG,
+  ISO14443_4   // DESFire, phones and other cards without Classic sectors
 };
 
 // Custom sector configuration for card data storage
@@ -37,18 +40,90 @@ enum class NFCCardType {
 #define CARD_MAGIC_BYTE1 0xAC  // Access Control
 #define CARD_MAGIC_BYTE2 0xDB  // DataBase
 
+// Block 5 metadata: [timestamp x4][flags][XOR of block 4][reserved]
+#define CLONE_FLAG_VALID 0x01
+
+// Data blocks (trailer excluded) per Mifare Classic sector; 4K sectors
+// 32-39 have 16 blocks instead of 4
+#define MIFARE_SECTOR_DATA_BLOCKS(sector) ((sector) < 32 ? 3 : 15)
+#define MIFARE_SECTOR_FIRST_BLOCK(sector) ((sector) < 32 ? (sector) * 4 : 128 + ((sector) - 32) * 16)
+#define MIFARE_BLOCK_SECTOR(block)        ((block) < 128 ? (block) / 4 : 32 + ((block) - 128) / 16)
+#define MIFARE_IS_TRAILER(block)          ((block) < 128 ? ((block) + 1) % 4 == 0 : ((block) + 1) % 16 == 0)
+
+// Pages per NTAG FAST_READ; 5 pages is the most a reply can carry in the
+// 32-byte PN532 frame buffer. READ always returns 4.
+#define NTAG_FAST_READ_PAGES 5
+
+// Cache of decoded custom sector results, keyed by physical UID, so repeat
+// taps of the same card skip the sector 1 authentication and read
+#ifndef NFC_SECTOR_CACHE_SIZE
+#define NFC_SECTOR_CACHE_SIZE 4        // Entries, least recently used evicted (~20 bytes RAM each)
+#endif
+
+#ifndef NFC_SECTOR_CACHE_TTL
+#define NFC_SECTOR_CACHE_TTL  600000UL // ms an entry stays valid, 0 disables the cache
+#endif
+
+// Default HSU port. Serial carries the console log, so HSU needs a second
+// UART; boards without Serial1 (Nano, Uno) have no default and must pass
+// one to setHSUPort().
+#if !defined(NFC_HSU_SERIAL) && defined(HAVE_HWSERIAL1)
+#define NFC_HSU_SERIAL Serial1
+#endif
+
+// Adaptive polling (NFCReadMode::POLLING): fast after a card or
+// notifyActivity(), slow once nothing has happened for NFC_POLL_IDLE_AFTER.
+// Most taps come after an idle spell, so the slow interval bounds their
+// latency (about interval / 2 + NFC_POLL_TIMEOUT on average); the duty
+// cycle saving comes mostly from the short NFC_POLL_TIMEOUT.
+#ifndef NFC_POLL_FAST_INTERVAL
+#define NFC_POLL_FAST_INTERVAL 40      // ms between polls while active
+#endif
+#ifndef NFC_POLL_SLOW_INTERVAL
+#define NFC_POLL_SLOW_INTERVAL 150     // ms between polls when idle
+#endif
+#ifndef NFC_POLL_IDLE_AFTER
+#define NFC_POLL_IDLE_AFTER    30000UL // ms without activity before backing off
+#endif
+#ifndef NFC_POLL_TIMEOUT
+#define NFC_POLL_TIMEOUT       20      // ms the PN532 searches per poll, capped at the interval
+#endif
+#define NFC_POLL_WINDOW        10000UL // ms over which the duty cycle is measured
+
+// RF field. MxRtyPassiveActivation bounds each polling InListPassiveTarget
+// inside the PN532 (0xFF = until a card shows up or the host gives up).
+#ifndef NFC_PASSIVE_RETRIES
+#define NFC_PASSIVE_RETRIES    PN532_RETRY_FOREVER
+#endif
+#ifndef NFC_ACTIVATION_MICROS
+#define NFC_ACTIVATION_MICROS  1000    // Field on per InAutoPoll slot without a card (estimate)
+#endif
+
+// Readers per firmware image (IRQ trampolines and NFCReaderGroup slots)
+#ifndef NFC_MAX_READERS
+#define NFC_MAX_READERS        2
+#endif
+
 // Card information structure
 struct NFCCardInfo {
   bool detected;
   uint8_t uid[7];          // Physical UID from manufacturer block
   uint8_t uidLength;
-  NFCCardType cardType;
+  NFCCardType cardType;    // From SAK, refined by GET_VERSION for SAK 0x00
   uint32_t cardID;         // For 4-byte UIDs
+  uint16_t atqa;
+  uint8_t sak;
+  uint8_t storageSize;     // GET_VERSION storage byte (NTAG/Ultralight EV1), 0 = unknown
   
   // Custom sector data
   bool hasClonedUID;       // True if card has been initialized with cloned data
   uint8_t clonedUID[7];    // UID stored in our custom sector
   uint8_t clonedUIDLength;
+  bool sectorPending;      // Custom sector not read yet (readCard(true) only)
+  
+  // Block 5 metadata, decoded by readCustomSector() only
+  uint32_t cloneTimestamp;
+  uint8_t cloneFlags;      // 0 = no valid metadata block
   
   // For access control, use clonedUID if hasClonedUID=true, otherwise use uid
   const uint8_t* getEffectiveUID() const { return hasClonedUID ? clonedUID : uid; }
@@ -60,6 +135,23 @@ struct NFCWriteResult {
   bool success;
   bool verified;  // If verification was performed
   String errorMessage;
+  
+  // NTAG writes: bit i set when page firstPage + i failed verification
+  // (mismatch or no read back). 64 pages covers a 255-byte write.
+  uint8_t firstPage = 0;
+  uint64_t failedPages = 0;
+  bool pageFailed(uint8_t page) const {
+    return page >= firstPage && page - firstPage < 64 && ((failedPages >> (page - firstPage)) & 1);
+  }
+};
+
+// Cached custom sector result for one physical UID
+struct SectorCacheEntry {
+  uint8_t uid[7];
+  uint8_t uidLength;        // 0 = unused entry
+  uint8_t clonedUID[7];
+  uint8_t clonedUIDLength;  // 0 = card has no cloned UID
+  unsigned long storedAt;
 };
 
 // Default Mifare Classic authentication key
@@ -76,34 +168,60 @@ public:
   // Initialization
   bool begin();
   
-  // Card detection and reading
-  NFCCardInfo readCard();
+  // Card detection and reading. readCard() never waits on the PN532:
+  // each call advances the current read by at most one step and returns
+  // detected = true once the UID (and custom sector) are in.
+  // With reportUIDFirst, a Classic card whose sector is not cached is
+  // reported right after anticollision with sectorPending = true, then
+  // again once the sector is read. After skipCustomSector() the sector is
+  // still read, to fill the cache, but the card is not reported again.
+  NFCCardInfo readCard(bool reportUIDFirst = false);
+  void skipCustomSector();
+  bool isReadInProgress() const { return _readPhase != ReadPhase::IDLE; }
   bool isCardPresent();
   
   // Writing methods
   // Write to NTAG/Ultralight (page-based, 4 bytes per page)
   NFCWriteResult writeNTAG(uint8_t page, const uint8_t* data, uint8_t dataLength, bool verify = true);
-  NFCWriteResult writeNTAGString(uint8_t startPage, const String& text, bool verify = true);
+  // With deferVerify, all pages are written first and then checked with
+  // multi-page reads instead of one read per page
+  NFCWriteResult writeNTAGString(uint8_t startPage, const String& text, bool verify = true, bool deferVerify = false);
   
   // Write to Mifare Classic (block-based, 16 bytes per block)
   NFCWriteResult writeMifareClassic(uint8_t block, const uint8_t* data, uint8_t dataLength, 
                                      const uint8_t* key = DEFAULT_KEY, bool useKeyB = false, bool verify = true);
   NFCWriteResult writeMifareClassicString(uint8_t startBlock, const String& text, 
                                            const uint8_t* key = DEFAULT_KEY, bool useKeyB = false, bool verify = true);
+  // Consecutive data blocks from startBlock, trailers skipped; one
+  // authentication per sector covers its writes and verify reads
+  NFCWriteResult writeMifareClassicBlocks(uint8_t startBlock, const uint8_t* data, uint16_t dataLength,
+                                          const uint8_t* key = DEFAULT_KEY, bool useKeyB = false, bool verify = true);
   
-  // Generic write that auto-detects card type
-  NFCWriteResult writeData(const uint8_t* data, uint8_t dataLength, uint8_t startAddress = 0, bool verify = true);
-  NFCWriteResult writeString(const String& text, uint8_t startAddress = 0, bool verify = true);
+  // Generic write that auto-detects card type; deferVerify applies to
+  // NTAG/Ultralight (Classic already verifies inside each sector session)
+  NFCWriteResult writeData(const uint8_t* data, uint8_t dataLength, uint8_t startAddress = 0,
+                           bool verify = true, bool deferVerify = false);
+  NFCWriteResult writeString(const String& text, uint8_t startAddress = 0, bool verify = true, bool deferVerify = false);
   
   // Read methods for verification
   bool readNTAGPage(uint8_t page, uint8_t* buffer);
+  // count pages into buffer (count * 4 bytes), using every page of each
+  // 16-byte READ, or FAST_READ on NTAG
+  bool readNTAGPages(uint8_t startPage, uint8_t count, uint8_t* buffer);
   bool readMifareClassicBlock(uint8_t block, uint8_t* buffer, const uint8_t* key = DEFAULT_KEY, bool useKeyB = false);
+  // All data blocks of a sector under one authentication; buffer holds
+  // MIFARE_SECTOR_DATA_BLOCKS(sector) * 16 bytes
+  bool readMifareClassicSector(uint8_t sector, uint8_t* buffer, const uint8_t* key = DEFAULT_KEY, bool useKeyB = false);
   
   // Custom sector operations for card cloning
-  bool readCustomSector(NFCCardInfo& info);  // Read our custom sector data
-  bool writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength);  // Clone UID to custom sector
+  bool readCustomSector(NFCCardInfo& info);  // Read our custom sector data (UID and metadata)
+  // Clone UID to custom sector; timestamp (Unix time, 0 = unknown) goes into block 5
+  bool writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength, uint32_t timestamp = 0);
   bool isCardInitialized();  // Check if card has our custom sector data
   bool initializeCard();  // Initialize blank card with empty custom sector
+  void clearSectorCache();
+  uint16_t getSectorCacheHits() const { return _sectorCacheHits; }
+  uint16_t getSectorCacheMisses() const { return _sectorCacheMisses; }
   
   // Get firmware version
   uint32_t getFirmwareVersion();
@@ -112,7 +230,8 @@ public:
   NFCCommMode getCommMode() const { return _commMode; }
   NFCReadMode getReadMode() const { return _readMode; }
   
-  // IRQ handling
+  // IRQ handling. Each reader in IRQ mode gets its own interrupt
+  // trampoline in begin(), so every reader needs its own interrupt pin.
   void handleIRQ();
   bool hasIRQEvent();
   void clearIRQEvent();
@@ -121,15 +240,61 @@ public:
   void resetCardState(); // Call after processing card to allow new detection
   bool wasCardRemoved(); // Check if card was removed
   
+  // Adaptive polling; telemetry is only tracked in POLLING mode
+  void notifyActivity() { _lastActivityTime = millis(); }  // Someone is at the reader
+  uint16_t getPollInterval() const { return _pollInterval; }
+  uint8_t getPollDutyCycle() const { return _pollDutyCycle; }  // % of the last window spent searching
+  
+  // RF field control. Duty cycling switches the field off after every
+  // empty poll (POLLING); an autopoll period makes IRQ mode arm InAutoPoll,
+  // which polls every period x 150 ms with the field off in between,
+  // instead of InListPassiveTarget (0 = off).
+  bool setPassiveActivationRetries(uint8_t retries);
+  void setFieldDutyCycling(bool enabled) { _fieldDutyCycling = enabled; }
+  void setAutoPollPeriod(uint8_t period) { _autoPollPeriod = period; }
+  
+  // Field and latency telemetry since begin() or resetFieldStats()
+  uint16_t getFieldOnSecondsPerHour();
+  uint32_t getAverageDetectionLatency();  // us from a card entering the field to its UID,
+                                          // anticollision excluded in IRQ mode
+  void resetFieldStats();
+  void printPollStats();
+  
   // Configuration
   void setIRQPin(uint8_t pin) { _irqPin = pin; }
   void setResetPin(uint8_t pin) { _resetPin = pin; }
   void setSPIPins(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss);
+  // SPI mode: 0 bit-bangs the setSPIPins() pins (default), otherwise the
+  // hardware SPI peripheral runs at this clock with ss as chip select
+  void setSPIClock(uint32_t clock) { _spiClock = clock; }
+  // I2C mode: bus clock, 100 kHz by default, up to 400 kHz (fast mode)
+  void setI2CClock(uint32_t clock) { _i2cClock = clock; }
+  // HSU mode: serial port and baud rate (115200 by default; others are
+  // switched to with SetSerialBaudRate after wakeup), and the length of
+  // the wakeup preamble
+  void setHSUPort(HardwareSerial& serial) { _hsuSerial = &serial; }
+  void setHSUBaud(uint32_t baud) { _hsuBaud = baud; }
+  void setHSUWakeupLength(uint8_t length) { _hsuWakeupLength = length; }
+  // SPI mode: drive SS high, so traffic for other readers on the same bus
+  // does not reach this PN532 before its begin()
+  void releaseChipSelect();
+  // POLLING mode: the IRQ pin is wired, so wait for responses on it
+  // instead of reading the status byte (IRQ mode always does, except
+  // over HSU where a frame is only in once its last byte has arrived)
+  void setIRQReady(bool enabled) { _irqReady = enabled; }
+  
+  // Bus traffic to the PN532: totals since begin() or resetBusStats(),
+  // and the current or last PN532 command (auth, block read, poll...)
+  PN532BusStats getBusStats() const;
+  PN532BusStats getCommandBusStats() const;
+  void resetBusStats();
+  void printBusStats();
   
 private:
   NFCCommMode _commMode;
   NFCReadMode _readMode;
-  Adafruit_PN532* _nfc;
+  PN532Transport* _transport;
+  PN532* _nfc;
   
   // Pin configurations
   uint8_t _irqPin;
@@ -138,26 +303,95 @@ private:
   uint8_t _spiMISO;
   uint8_t _spiMOSI;
   uint8_t _spiSS;
+  uint32_t _spiClock;
+  uint32_t _i2cClock;
+  HardwareSerial* _hsuSerial;
+  uint32_t _hsuBaud;
+  uint8_t _hsuWakeupLength;
+  bool _irqReady;
   
   // IRQ state
+  int8_t _irqSlot;  // Trampoline slot, -1 when none is claimed
   volatile bool _cardPresent;
   unsigned long _lastIRQTime;
+  volatile unsigned long _lastIRQMicros;  // Latest IRQ edge, for the tap tracer
   
-  // Polling throttle
+  // Polling scheduler
   unsigned long _lastPollTime;
-  static const unsigned long POLL_INTERVAL = 100; // ms between polls
+  unsigned long _detectionStartMicros;
+  unsigned long _lastActivityTime;
+  uint16_t _pollInterval;
+  unsigned long _pollWindowStart;
+  unsigned long _pollBusyMicros;  // Searching time in the current window
+  uint8_t _pollDutyCycle;
+  unsigned long _pollWindowMicros;  // Average search length, for the latency estimate
+  void schedulePoll(unsigned long now);
+  void endPoll();
+  
+  // RF field state and telemetry
+  uint8_t _passiveRetries;
+  bool _fieldDutyCycling;
+  uint8_t _autoPollPeriod;
+  bool _autoPolling;                // InAutoPoll armed
+  unsigned long _autoPollStart;
+  bool _fieldOn;
+  unsigned long _fieldOnSince;
+  unsigned long _fieldOnMillis;
+  unsigned long _fieldStatsStart;
+  unsigned long _detectionMicros;   // Measured part of the detection latency
+  uint16_t _detections;
+  void setFieldOn(bool on);
+  unsigned long autoPollFieldMillis(unsigned long now);
   
   // Card presence tracking
   unsigned long _lastCardDetectedTime;
   bool _lastCardPresent;
   static const unsigned long CARD_TIMEOUT = 1000; // ms before considering card removed
   
+  // Split-phase card read
+  enum class ReadPhase : uint8_t {
+    IDLE,            // Nothing in flight
+    DETECTING,       // InListPassiveTarget sent
+    UID_REPORTED,    // Reported before the custom sector read, not started yet
+    AUTHENTICATING,  // Custom sector authentication sent
+    READING,         // Custom sector block read sent
+    IDENTIFYING,     // GET_VERSION sent to a SAK 0x00 tag
+    RESELECTING,     // InListPassiveTarget again after the tag NAKed GET_VERSION
+    FIELD_OFF        // RFConfiguration switching the field off after an empty poll
+  };
+  ReadPhase _readPhase;
+  bool _sectorUnreported;  // Custom sector read only fills the cache
+  void startDetection();
+  void pollDetection(NFCCardInfo& info, bool reportUIDFirst);
+  void startCustomSector();
+  void pollCustomSector(NFCCardInfo& info);
+  void pollIdentification(NFCCardInfo& info);
+  void pollFieldOff();
+  void cancelRead();
+  bool claimIRQSlot();
+  
   // Helper methods
-  NFCCardType determineCardType(uint8_t uidLength);
+  NFCCardType determineCardType(uint8_t sak);
   uint32_t calculateCardID(uint8_t* uid, uint8_t uidLength);
   void printCardInfo(const NFCCardInfo& info);
   bool authenticateMifareBlock(uint8_t block, const uint8_t* key, bool useKeyB, const uint8_t* uid, uint8_t uidLength);
+  bool readSectorBlocks(uint8_t sector, uint8_t* buffer, const uint8_t* key, bool useKeyB,
+                        const uint8_t* uid, uint8_t uidLength);
   bool verifyWrite(const uint8_t* expected, const uint8_t* actual, uint8_t length);
+  NFCWriteResult writeNTAGPages(uint8_t startPage, const uint8_t* data, uint8_t dataLength, bool verify, bool deferVerify);
+  void verifyNTAGPages(NFCWriteResult& result, const uint8_t* data, uint8_t dataLength);
+  bool decodeCustomSector(NFCCardInfo& info, const uint8_t* blockData);
+  void decodeCloneMetadata(NFCCardInfo& info, const uint8_t* uidBlock, const uint8_t* metadataBlock);
+  
+  // Custom sector cache (index 0 = most recently used)
+  SectorCacheEntry _sectorCache[NFC_SECTOR_CACHE_SIZE];
+  uint16_t _sectorCacheHits;
+  uint16_t _sectorCacheMisses;
+  bool lookupSectorCache(NFCCardInfo& info);
+  void storeSectorCache(const NFCCardInfo& info);
+  void invalidateSectorCache(const uint8_t* uid, uint8_t uidLength);
+  int8_t findSectorCacheEntry(const uint8_t* uid, uint8_t uidLength);
+  void promoteSectorCacheEntry(uint8_t index);
   
   // Store last card info for write operations
   NFCCardInfo _lastCardInfo;
@@ -0,0 +1,38 @@
+#ifndef NFC_READER_GROUP_H
+#define NFC_READER_GROUP_H
+
+#include <Arduino.h>
+#include "NFCReader.h"
+
+// Several readers driven from one loop, e.g. entry and exit at a door.
+//
+// readCard() advances one reader by one step and then passes the turn
+// on, whatever phase that reader is in. A Classic authentication on one
+// reader therefore holds the others up by a single bus transaction, not
+// by the whole sector read. lastReader() is the reader the last result
+// came from, for follow-ups such as skipCustomSector() or card writes.
+class NFCReaderGroup {
+public:
+  NFCReaderGroup();
+
+  bool add(NFCReader& reader);  // Before begin(); false once NFC_MAX_READERS are in
+  bool begin();                 // Every reader; false if any fails
+
+  NFCCardInfo readCard(bool reportUIDFirst = false);
+  NFCReader& lastReader() { return *_readers[_last]; }
+  uint8_t lastReaderIndex() const { return _last; }
+
+  uint8_t count() const { return _count; }
+  NFCReader& reader(uint8_t index) { return *_readers[index]; }
+
+  // Applied to every reader
+  void notifyActivity();
+  void resetCardState();
+
+private:
+  NFCReader* _readers[NFC_MAX_READERS];
+  uint8_t _count;
+  uint8_t _last;  // Stepped by the last readCard()
+};
+
+#endif // NFC_READER_GROUP_H
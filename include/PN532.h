@@ -0,0 +1,152 @@
+#ifndef PN532_H
+#define PN532_H
+
+#include <Arduino.h>
+#include "PN532Transport.h"
+
+// PN532 commands
+#define PN532_COMMAND_GETFIRMWAREVERSION  0x02
+#define PN532_COMMAND_SAMCONFIGURATION    0x14
+#define PN532_COMMAND_RFCONFIGURATION     0x32
+#define PN532_COMMAND_INDATAEXCHANGE      0x40
+#define PN532_COMMAND_INCOMMUNICATETHRU   0x42
+#define PN532_COMMAND_INLISTPASSIVETARGET 0x4A
+#define PN532_COMMAND_INAUTOPOLL          0x60
+
+// RFConfiguration items
+#define PN532_RFCFG_FIELD    0x01  // Bit 0: RF field on
+#define PN532_RFCFG_RETRIES  0x05  // MxRtyATR, MxRtyPSL, MxRtyPassiveActivation
+
+#define PN532_RETRY_FOREVER  0xFF
+#define PN532_AUTOPOLL_TYPE_MIFARE 0x10  // 106 kbps type A
+
+#define PN532_MIFARE_ISO14443A 0x00
+
+// Card commands sent through InDataExchange
+#define MIFARE_CMD_AUTH_A           0x60
+#define MIFARE_CMD_AUTH_B           0x61
+#define MIFARE_CMD_READ             0x30
+#define MIFARE_CMD_WRITE            0xA0
+#define MIFARE_ULTRALIGHT_CMD_WRITE 0xA2
+#define NTAG_CMD_FAST_READ          0x3A
+#define NTAG_CMD_GET_VERSION        0x60  // Sent through InCommunicateThru, it clashes with AUTH_A
+
+// GET_VERSION reply: [header][vendor][product type][subtype][major][minor][storage size][protocol]
+#define NTAG_VERSION_LENGTH       8
+#define NTAG_PRODUCT_ULTRALIGHT   0x03
+#define NTAG_PRODUCT_NTAG         0x04
+
+// Frame buffer size; the AVR Wire library moves at most 32 bytes per transfer
+#define PN532_BUFFER_SIZE 32
+
+// Frame bytes around the data: preamble, start code, LEN, LCS, TFI, DCS, postamble
+#define PN532_FRAME_OVERHEAD 8
+
+// Longest a blocking call waits for a command started without a timeout (ms)
+#define PN532_BLOCKING_TIMEOUT 1000
+
+enum class PN532Status : uint8_t {
+  IDLE,    // No command issued
+  BUSY,    // Waiting for the ACK or the response
+  DONE,    // Response available through response()
+  FAILED   // No ACK, bad frame or timeout
+};
+
+// PN532 host controller protocol with split-phase commands.
+//
+// startCommand() writes a command frame and returns straight away.
+// poll() checks whether the PN532 has something to say (the IRQ line
+// if one is set, else a status read) and collects the ACK, then the
+// response, a single short transfer per call. The blocking helpers wrap
+// both for setup code and card writes.
+class PN532 {
+public:
+  PN532(PN532Transport& transport);
+
+  void begin();
+  void setIrqPin(int8_t pin) { _irqPin = pin; }  // -1 = use status reads
+
+  // Split-phase interface; starting a command aborts any still in flight
+  void startCommand(const uint8_t* command, uint8_t length, uint8_t responseLength, uint16_t timeout);
+  PN532Status poll();
+  PN532Status status() const { return _status; }
+  void abort();
+  const uint8_t* response() const { return &_buffer[_responseStart]; }
+  uint8_t responseLength() const { return _responseLength; }
+
+  // Blocking command: true once the response has arrived. A timeout of 0
+  // is capped at PN532_BLOCKING_TIMEOUT.
+  bool command(const uint8_t* command, uint8_t length, uint8_t responseLength, uint16_t timeout = 100);
+  
+  // Bus traffic in total, and for the current or last command from its
+  // frame to the response (status reads included)
+  const PN532BusStats& busStats() const { return _transport.stats(); }
+  PN532BusStats commandBusStats() const;
+  void resetBusStats() { _transport.resetStats(); _commandStats = PN532BusStats(); }
+
+  // Setup
+  uint32_t getFirmwareVersion();
+  bool SAMConfig();
+  
+  // RF configuration. Passive activation retries bound how long
+  // InListPassiveTarget searches (PN532_RETRY_FOREVER = until a card
+  // shows up). InListPassiveTarget switches the field on by itself.
+  bool setPassiveActivationRetries(uint8_t retries);
+  bool setRFField(bool on);
+  void startRFField(bool on);
+
+  // Target detection; timeout 0 waits until a card enters the field.
+  // Only the target data up to the UID is guaranteed; a long ATS is cut off.
+  void startListPassiveTarget(uint16_t timeout);
+  bool readPassiveTarget(uint8_t* uid, uint8_t* uidLength,
+                         uint16_t* atqa = nullptr, uint8_t* sak = nullptr);  // After DONE
+  
+  // InAutoPoll: the PN532 polls for a type A card every period x 150 ms
+  // with the field off in between, pollCount times (0xFF = until found)
+  void startAutoPoll(uint8_t pollCount, uint8_t period);
+  bool readAutoPollTarget(uint8_t* uid, uint8_t* uidLength,
+                          uint16_t* atqa = nullptr, uint8_t* sak = nullptr);  // After DONE
+
+  // Card commands through InDataExchange, or InCommunicateThru for raw
+  // frames the PN532 must not interpret; both reply [status][data...]
+  void startDataExchange(const uint8_t* data, uint8_t length, uint8_t replyLength, uint16_t timeout = 100);
+  void startCommunicateThru(const uint8_t* data, uint8_t length, uint8_t replyLength, uint16_t timeout = 100);
+  bool readDataExchange(uint8_t* reply, uint8_t replyLength);  // After DONE; false on a card error
+  bool dataExchange(const uint8_t* data, uint8_t length, uint8_t* reply = nullptr, uint8_t replyLength = 0);
+
+  void startMifareAuthenticate(uint8_t block, uint8_t keyType, const uint8_t* key, const uint8_t* uid, uint8_t uidLength);
+  void startMifareRead(uint8_t block);
+  bool mifareAuthenticate(uint8_t block, uint8_t keyType, const uint8_t* key, const uint8_t* uid, uint8_t uidLength);
+  bool mifareReadBlock(uint8_t block, uint8_t* data);  // 16 bytes; 4 pages on Ultralight/NTAG
+  bool mifareWriteBlock(uint8_t block, const uint8_t* data);
+  bool ultralightWritePage(uint8_t page, const uint8_t* data);
+  bool ntagFastRead(uint8_t startPage, uint8_t endPage, uint8_t* data);  // NTAG21x, 4 bytes per page
+  void startNtagGetVersion();  // NTAG_VERSION_LENGTH bytes through readDataExchange()
+
+private:
+  PN532Transport& _transport;
+  int8_t _irqPin;
+
+  PN532Status _status;
+  bool _awaitingAck;
+  uint8_t _command;
+  uint8_t _expectedLength;  // Response bytes to read, frame included
+  uint16_t _timeout;
+  unsigned long _startedAt;
+
+  uint8_t _buffer[PN532_BUFFER_SIZE];
+  uint8_t _responseStart;
+  uint8_t _responseLength;
+  PN532BusStats _commandStats;  // Transport totals when the command started
+
+  bool isReady();
+  bool readAck();
+  bool readResponse();
+  void startTargetCommand(uint8_t command, const uint8_t* data, uint8_t length, uint8_t replyLength, uint16_t timeout);
+  bool waitForResponse();
+  bool parseTarget(const uint8_t* data, uint8_t length, uint8_t* uid, uint8_t* uidLength, uint16_t* atqa, uint8_t* sak);
+  uint8_t buildAuthenticate(uint8_t* data, uint8_t block, uint8_t keyType, const uint8_t* key,
+                            const uint8_t* uid, uint8_t uidLength);
+};
+
+#endif // PN532_H
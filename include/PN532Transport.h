@@ -0,0 +1,154 @@
+#ifndef PN532_TRANSPORT_H
+#define PN532_TRANSPORT_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+// PN532 I2C address (7-bit)
+#define PN532_I2C_ADDRESS 0x24
+
+// SPI operation bytes, sent first after SS goes low
+#define PN532_SPI_DATA_WRITE  0x01
+#define PN532_SPI_STATUS_READ 0x02
+#define PN532_SPI_DATA_READ   0x03
+
+// Bit 0 of the status byte (SPI status read, first byte of every I2C read)
+#define PN532_STATUS_READY    0x01
+
+// Highest bus clocks the PN532 supports
+#define PN532_SPI_MAX_CLOCK   5000000UL
+#define PN532_I2C_MAX_CLOCK   400000UL
+
+// HSU (UART): the PN532 always starts at 115200 baud, 8N1
+#define PN532_HSU_DEFAULT_BAUD     115200UL
+#define PN532_HSU_WAKEUP_LENGTH    16   // 0x55 0x55 then zeros
+#define PN532_HSU_FRAME_SIZE       40   // Frame bytes kept; the rest of a longer frame is dropped
+#define PN532_COMMAND_SETSERIALBAUDRATE 0x10
+
+// Bus traffic, operation and status bytes included
+struct PN532BusStats {
+  uint32_t bytes;
+  uint32_t micros;         // Time spent inside transport calls
+  uint32_t transactions;
+};
+
+// Bus link to the PN532. Each call is a single short bus transaction;
+// framing, checksums and ACK handling live in the PN532 class.
+class PN532Transport {
+public:
+  virtual ~PN532Transport() {}
+
+  virtual void begin() = 0;
+  virtual void wakeup() = 0;
+
+  // True when the PN532 has an ACK or response frame waiting
+  virtual bool isReady() = 0;
+
+  virtual void writeFrame(const uint8_t* frame, uint8_t length) = 0;
+  virtual void readFrame(uint8_t* buffer, uint8_t length) = 0;
+
+  const PN532BusStats& stats() const { return _stats; }
+  void resetStats() { _stats = PN532BusStats(); }
+
+protected:
+  PN532BusStats _stats = PN532BusStats();
+
+  // Charge one transaction that started at startMicros
+  void account(uint8_t bytes, unsigned long startMicros) {
+    _stats.bytes += bytes;
+    _stats.micros += micros() - startMicros;
+    _stats.transactions++;
+  }
+};
+
+// Bit-banged SPI (mode 0, LSB first) on any four pins
+class PN532SoftSPI : public PN532Transport {
+public:
+  PN532SoftSPI(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss);
+
+  void begin() override;
+  void wakeup() override;
+  bool isReady() override;
+  void writeFrame(const uint8_t* frame, uint8_t length) override;
+  void readFrame(uint8_t* buffer, uint8_t length) override;
+
+private:
+  uint8_t _sck;
+  uint8_t _miso;
+  uint8_t _mosi;
+  uint8_t _ss;
+
+  uint8_t transfer(uint8_t out);
+};
+
+// AVR SPI peripheral (mode 0, LSB first) on the board's SCK/MISO/MOSI
+// pins, with any pin as SS. The clock is capped at PN532_SPI_MAX_CLOCK.
+class PN532HardSPI : public PN532Transport {
+public:
+  PN532HardSPI(uint8_t ss, uint32_t clock);
+
+  void begin() override;
+  void wakeup() override;
+  bool isReady() override;
+  void writeFrame(const uint8_t* frame, uint8_t length) override;
+  void readFrame(uint8_t* buffer, uint8_t length) override;
+
+private:
+  uint8_t _ss;
+  SPISettings _settings;
+
+  void select();
+  void deselect();
+};
+
+// I2C through the Wire library, at up to PN532_I2C_MAX_CLOCK (fast mode).
+// Every read starts with a status byte, which readFrame() strips.
+class PN532I2C : public PN532Transport {
+public:
+  PN532I2C(uint8_t resetPin, uint32_t clock = 100000);
+
+  void begin() override;
+  void wakeup() override;
+  bool isReady() override;
+  void writeFrame(const uint8_t* frame, uint8_t length) override;
+  void readFrame(uint8_t* buffer, uint8_t length) override;
+
+private:
+  uint8_t _resetPin;
+  uint32_t _clock;
+};
+
+// HSU on a hardware serial port. The core's interrupt-driven ring buffer
+// takes bytes off the line; isReady() moves them into a frame buffer and
+// reports true once a whole ACK or response frame is in. With a baud rate
+// other than 115200, wakeup() moves both ends over with SetSerialBaudRate.
+class PN532HSU : public PN532Transport {
+public:
+  PN532HSU(HardwareSerial& serial, uint32_t baud = PN532_HSU_DEFAULT_BAUD,
+           uint8_t wakeupLength = PN532_HSU_WAKEUP_LENGTH);
+
+  void begin() override;
+  void wakeup() override;
+  bool isReady() override;
+  void writeFrame(const uint8_t* frame, uint8_t length) override;
+  void readFrame(uint8_t* buffer, uint8_t length) override;
+
+  uint32_t baud() const { return _baud; }  // Rate in use after wakeup()
+
+private:
+  HardwareSerial& _serial;
+  uint32_t _requestedBaud;
+  uint32_t _baud;
+  uint8_t _wakeupLength;
+
+  // Frame assembly: _frame[0] is a 00 preamble so frames read like SPI
+  uint8_t _frame[PN532_HSU_FRAME_SIZE];
+  uint16_t _received;     // Frame bytes taken off the line, preamble included
+  uint16_t _frameLength;  // Complete length once known, else 0
+
+  void resetFrame();
+  bool changeBaud();
+  bool waitFrame(uint8_t responseCode, uint16_t timeout);
+};
+
+#endif // PN532_TRANSPORT_H
@@ -0,0 +1,69 @@
+#ifndef TAP_TRACER_H
+#define TAP_TRACER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Points along the path from a card entering the field to the relay
+enum class TracePoint : uint8_t {
+  IRQ,       // PN532 IRQ edge for the detection response (IRQ mode)
+  POLL,      // InListPassiveTarget issued (polling mode)
+  UID,       // Detection response parsed
+  SECTOR,    // Custom sector read finished (skipped on a cache hit)
+  DECISION,  // isCardAuthorized() returned
+  RELAY      // Relay pin switched in unlockDoor()
+};
+
+#ifdef TAP_TRACING
+
+// Timestamps each tap from the IRQ edge (or poll start) to the relay.
+//
+// Trace points go into a ring of TAP_TRACE_EVENTS entries. When a tap
+// ends, its points are printed on Serial as one line of offsets from the
+// start, and the tap-to-unlock time joins the last TAP_TRACE_HISTORY
+// taps for the p50/p95/max summary. Built with -DTAP_TRACING.
+class TapTracer {
+public:
+  TapTracer();
+
+  void startTap(TracePoint point, unsigned long at);  // at = micros() of the first point
+  void mark(TracePoint point);                         // Ignored outside a tap
+  void endTap(bool unlocked);
+
+  void reset();
+  void printSummary();  // p50/p95/max tap-to-unlock on Serial
+
+private:
+  struct Event {
+    unsigned long at;
+    TracePoint point;
+  };
+
+  Event _events[TAP_TRACE_EVENTS];
+  uint8_t _head;         // Next slot to write
+  uint8_t _tapStart;     // Slot of the open tap's first point
+  bool _tapOpen;
+
+  uint32_t _latencies[TAP_TRACE_HISTORY];  // Tap-to-unlock, us
+  uint8_t _latencyHead;
+  uint8_t _latencyCount;
+
+  void add(TracePoint point, unsigned long at);
+  void printTap();
+};
+
+extern TapTracer TapTrace;
+
+#define TAP_TRACE_START(point, at) TapTrace.startTap(point, at)
+#define TAP_TRACE(point) TapTrace.mark(point)
+#define TAP_TRACE_END(unlocked) TapTrace.endTap(unlocked)
+
+#else
+
+#define TAP_TRACE_START(point, at)
+#define TAP_TRACE(point)
+#define TAP_TRACE_END(unlocked)
+
+#endif // TAP_TRACING
+
+#endif // TAP_TRACER_H
@@ -0,0 +1,127 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host stand-in for the Arduino AVR core (see NativeHAL.h)
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#include "WString.h"
+#include "Print.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// ========== PIN DEFINITIONS (Arduino Nano) ==========
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+#define NUM_DIGITAL_PINS 22
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define SS   10
+#define MOSI 11
+#define MISO 12
+#define SCK  13
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+// ========== EEPROM SIZE (ATmega328P) ==========
+
+#ifndef E2END
+#define E2END 0x3FF
+#endif
+
+// ========== PROGMEM ==========
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+// ========== MATH ==========
+
+template<class A, class B> inline auto min(A a, B b) -> typename std::decay<decltype(a < b ? a : b)>::type { return a < b ? a : b; }
+template<class A, class B> inline auto max(A a, B b) -> typename std::decay<decltype(a > b ? a : b)>::type { return a > b ? a : b; }
+template<class T, class L, class H> inline T constrain(T x, L lo, H hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+// ========== CORE API ==========
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts();
+void noInterrupts();
+
+// ========== SERIAL ==========
+
+// Serial is the console (captured, see NativeHAL.h); Serial1 is a UART
+// on a pseudo-terminal for device models such as the PN532 in HSU mode
+class HardwareSerial : public Print {
+public:
+  explicit HardwareSerial(uint8_t port = 0) : _port(port) {}
+
+  void begin(unsigned long baud);
+  void end() {}
+  int available();
+  int peek();
+  int read();
+  void flush();
+  size_t write(uint8_t c) override;
+  using Print::write;
+  operator bool() const { return true; }
+
+private:
+  uint8_t _port;
+};
+
+#define HAVE_HWSERIAL1
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,108 @@
+#include "EEPROM.h"
+#include "NativeHAL.h"
+
+namespace {
+
+uint8_t gData[E2END + 1];
+uint32_t gWrites[E2END + 1];
+uint32_t gTotalWrites = 0;
+uint64_t gBusyUntil = 0;
+bool gInitialized = false;
+void (*gReadyISR)() = nullptr;
+bool gReadyArmed = false;
+
+void ensureInitialized() {
+  if (!gInitialized) {
+    memset(gData, 0xFF, sizeof(gData));
+    memset(gWrites, 0, sizeof(gWrites));
+    gInitialized = true;
+  }
+}
+
+// eeprom_read_byte()/eeprom_write_byte() spin on EEPE first
+void waitIdle() {
+  uint64_t now = NativeHAL::nowMicros();
+  if (gBusyUntil > now) {
+    NativeHAL::advanceMicros((uint32_t)(gBusyUntil - now));
+  }
+}
+
+// Fire the ready ISR once the EEPROM is idle, and again after every
+// write it starts, for as long as it stays enabled
+void armReadyInterrupt() {
+  if (!gReadyISR || gReadyArmed) return;
+  gReadyArmed = true;
+  uint64_t now = NativeHAL::nowMicros();
+  NativeHAL::schedule(gBusyUntil > now ? gBusyUntil : now, []() {
+    gReadyArmed = false;
+    if (!gReadyISR) return;
+    if (gBusyUntil <= NativeHAL::nowMicros()) {
+      gReadyISR();
+    }
+    armReadyInterrupt();
+  });
+}
+
+} // namespace
+
+EEPROMClass EEPROM;
+
+uint8_t EEPROMClass::read(int idx) {
+  ensureInitialized();
+  waitIdle();
+  NativeHAL::advanceMicros(NativeHAL::costs().eepromReadMicros);
+  if (idx < 0 || idx > E2END) return 0xFF;
+  return gData[idx];
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  ensureInitialized();
+  waitIdle();
+  if (idx < 0 || idx > E2END) return;
+  gData[idx] = val;
+  gWrites[idx]++;
+  gTotalWrites++;
+  gBusyUntil = NativeHAL::nowMicros() + NativeHAL::costs().eepromWriteMicros;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (read(idx) != val) {
+    write(idx, val);
+  }
+}
+
+namespace NativeHAL {
+
+uint8_t* eepromData() {
+  ensureInitialized();
+  return gData;
+}
+
+uint32_t eepromWriteCount(uint16_t address) {
+  ensureInitialized();
+  return address <= E2END ? gWrites[address] : 0;
+}
+
+void eepromReadyInterrupt(void (*isr)()) {
+  gReadyISR = isr;
+  armReadyInterrupt();
+}
+
+void eepromResetInterrupt() {
+  gReadyISR = nullptr;
+  gReadyArmed = false;
+}
+
+uint32_t eepromTotalWrites() {
+  return gTotalWrites;
+}
+
+void eepromFill(uint8_t value) {
+  ensureInitialized();
+  memset(gData, value, sizeof(gData));
+  memset(gWrites, 0, sizeof(gWrites));
+  gTotalWrites = 0;
+  gBusyUntil = 0;
+}
+
+} // namespace NativeHAL
@@ -0,0 +1,37 @@
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Arduino.h"
+
+// 1 KB EEPROM backed by a host array. Writes follow the AVR timing:
+// a write starts programming the cell and returns, and the next EEPROM
+// access waits until the previous write has finished.
+class EEPROMClass {
+public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() { return E2END + 1; }
+
+  template<typename T> T& get(int idx, T& t) {
+    uint8_t* ptr = (uint8_t*)&t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ptr[i] = read(idx + (int)i);
+    }
+    return t;
+  }
+
+  template<typename T> const T& put(int idx, const T& t) {
+    const uint8_t* ptr = (const uint8_t*)&t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      update(idx + (int)i, ptr[i]);
+    }
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // NATIVE_EEPROM_H
@@ -0,0 +1,84 @@
+#include "LiquidCrystal.h"
+#include "NativeHAL.h"
+#include <string.h>
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t)
+  : _cols(16), _rows(2), _col(0), _row(0),
+    _dataBytes(0), _commands(0), _clears(0), _busMicros(0)
+{
+  memset(_ddram, ' ', sizeof(_ddram));
+}
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t)
+  : _cols(16), _rows(2), _col(0), _row(0),
+    _dataBytes(0), _commands(0), _clears(0), _busMicros(0)
+{
+  memset(_ddram, ' ', sizeof(_ddram));
+}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t rows, uint8_t) {
+  _cols = cols;
+  _rows = rows > MAX_ROWS ? MAX_ROWS : rows;
+  NativeHAL::registerLCD(this);
+  // Power-on init sequence of the Arduino library (~50 ms + 4 commands)
+  charge(50000);
+  for (uint8_t i = 0; i < 4; i++) {
+    command();
+  }
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  memset(_ddram, ' ', sizeof(_ddram));
+  _col = 0;
+  _row = 0;
+  _clears++;
+  command(NativeHAL::costs().lcdClearMicros);
+}
+
+void LiquidCrystal::home() {
+  _col = 0;
+  _row = 0;
+  command(NativeHAL::costs().lcdClearMicros);
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  if (row >= _rows) row = _rows - 1;
+  _col = col < DDRAM_COLS ? col : DDRAM_COLS - 1;
+  _row = row;
+  command();
+}
+
+size_t LiquidCrystal::write(uint8_t value) {
+  _ddram[_row][_col] = (char)value;
+  _col++;
+  if (_col >= DDRAM_COLS) {
+    _col = 0;
+    _row = (_row + 1) % _rows;
+  }
+  _dataBytes++;
+  charge(NativeHAL::costs().lcdByteMicros);
+  return 1;
+}
+
+std::string LiquidCrystal::line(uint8_t row) const {
+  if (row >= _rows) return std::string();
+  return std::string(_ddram[row], _cols);
+}
+
+void LiquidCrystal::resetCounters() {
+  _dataBytes = 0;
+  _commands = 0;
+  _clears = 0;
+  _busMicros = 0;
+}
+
+void LiquidCrystal::command(uint32_t extraMicros) {
+  _commands++;
+  charge(NativeHAL::costs().lcdByteMicros + extraMicros);
+}
+
+void LiquidCrystal::charge(uint32_t micros) {
+  _busMicros += micros;
+  NativeHAL::advanceMicros(micros);
+}
@@ -0,0 +1,61 @@
+#ifndef NATIVE_LIQUID_CRYSTAL_H
+#define NATIVE_LIQUID_CRYSTAL_H
+
+#include <stdint.h>
+#include <string>
+#include "Print.h"
+
+// Recording HD44780 driver: keeps the DDRAM contents that would be on
+// the glass, counts bus traffic and charges LiquidCrystal's 4-bit timing
+// to the virtual clock.
+class LiquidCrystal : public Print {
+public:
+  LiquidCrystal(uint8_t rs, uint8_t enable,
+                uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+  LiquidCrystal(uint8_t rs, uint8_t rw, uint8_t enable,
+                uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+
+  void begin(uint8_t cols, uint8_t rows, uint8_t charsize = 0);
+  void clear();
+  void home();
+  void setCursor(uint8_t col, uint8_t row);
+
+  void noDisplay() { command(); }
+  void display() { command(); }
+  void noCursor() { command(); }
+  void cursor() { command(); }
+  void noBlink() { command(); }
+  void blink() { command(); }
+  void createChar(uint8_t, uint8_t[]) { command(); }
+
+  size_t write(uint8_t value) override;
+  using Print::write;
+
+  // ===== Host-side inspection =====
+  std::string line(uint8_t row) const;
+  uint32_t dataBytes() const { return _dataBytes; }
+  uint32_t commandCount() const { return _commands; }
+  uint32_t clearCount() const { return _clears; }
+  uint64_t busMicros() const { return _busMicros; }
+  void resetCounters();
+
+private:
+  static const uint8_t DDRAM_COLS = 40;
+  static const uint8_t MAX_ROWS = 4;
+
+  char _ddram[MAX_ROWS][DDRAM_COLS];
+  uint8_t _cols;
+  uint8_t _rows;
+  uint8_t _col;
+  uint8_t _row;
+
+  uint32_t _dataBytes;
+  uint32_t _commands;
+  uint32_t _clears;
+  uint64_t _busMicros;
+
+  void command(uint32_t extraMicros = 0);
+  void charge(uint32_t micros);
+};
+
+#endif // NATIVE_LIQUID_CRYSTAL_H
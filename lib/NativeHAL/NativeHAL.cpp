@@ -0,0 +1,474 @@
+#include "Arduino.h"
+#include "NativeHAL.h"
+#include "LiquidCrystal.h"
+#include "Wire.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+struct PinState {
+  uint8_t mode = INPUT;
+  uint8_t output = LOW;
+  int8_t driven = -1;           // External level, -1 when floating
+  uint64_t lastChange = 0;
+  std::vector<std::function<void(uint8_t)>> watchers;
+};
+
+struct ScheduledEvent {
+  uint64_t at;
+  uint32_t seq;
+  std::function<void()> fn;
+};
+
+struct InterruptSlot {
+  void (*handler)(void) = nullptr;
+  int mode = 0;
+  bool pending = false;
+};
+
+NativeHAL::CostModel gCosts = {
+  3,      // digitalReadMicros
+  4,      // digitalWriteMicros
+  1,      // eepromReadMicros
+  3300,   // eepromWriteMicros
+  264,    // lcdByteMicros
+  2000,   // lcdClearMicros
+  20,     // i2cTransactionMicros
+  1,      // spiTransferMicros
+  1000,   // pn532AckMicros
+  3000,   // pn532ListMicros
+  4000,   // pn532AuthMicros
+  2500,   // pn532ReadMicros
+  6000,   // pn532WriteMicros
+  94,     // pn532RfByteMicros
+  51200,  // pn532NoAnswerMicros
+  1000    // pn532ActivationMicros
+};
+
+uint64_t gNow = 0;
+bool gInEvents = false;
+uint32_t gEventSeq = 0;
+std::vector<ScheduledEvent> gEvents;
+
+PinState gPins[NUM_DIGITAL_PINS];
+InterruptSlot gInterrupts[2];
+bool gInterruptsEnabled = true;
+
+bool gSerialEcho = false;
+unsigned long gSerialBaud = 115200;
+uint64_t gSerialTxBusyUntil = 0;
+std::deque<uint8_t> gSerialInput;
+std::string gSerialOutput;
+
+// Serial1: pseudo-terminal between the firmware (slave side) and a
+// device model (master side)
+struct UartPort {
+  unsigned long baud = 115200;
+  uint64_t txBusyUntil = 0;      // Firmware to device
+  uint64_t deviceBusyUntil = 0;  // Device to firmware
+  int master = -1;
+  int slave = -1;
+  std::string slaveName;
+  std::deque<uint8_t> input;     // Read from the slave side, not consumed yet
+  std::function<void(uint8_t, uint32_t)> device;
+};
+
+UartPort gUart;
+
+bool openUART() {
+  if (gUart.master >= 0) return true;
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0) return false;
+  const char* name = (grantpt(master) == 0 && unlockpt(master) == 0) ? ptsname(master) : nullptr;
+  int slave = name ? open(name, O_RDWR | O_NOCTTY) : -1;
+  if (slave < 0) {
+    close(master);
+    return false;
+  }
+
+  // Raw bytes both ways: no echo, no line editing, no CR/LF mapping
+  termios mode;
+  tcgetattr(slave, &mode);
+  cfmakeraw(&mode);
+  tcsetattr(slave, TCSANOW, &mode);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+  gUart.master = master;
+  gUart.slave = slave;
+  gUart.slaveName = name;
+  return true;
+}
+
+LiquidCrystal* gLCD = nullptr;
+
+bool eventLater(const ScheduledEvent& a, const ScheduledEvent& b) {
+  return a.at != b.at ? a.at > b.at : a.seq > b.seq;
+}
+
+int pinInterrupt(uint8_t pin) {
+  return digitalPinToInterrupt(pin);
+}
+
+uint8_t pinLevel(const PinState& p) {
+  if (p.mode == OUTPUT) return p.output;
+  if (p.driven >= 0) return (uint8_t)p.driven;
+  return p.mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+void fireInterrupt(int num) {
+  InterruptSlot& slot = gInterrupts[num];
+  if (!slot.handler) return;
+  if (!gInterruptsEnabled) {
+    slot.pending = true;
+    return;
+  }
+  slot.handler();
+}
+
+void levelChanged(uint8_t pin, uint8_t before, uint8_t after) {
+  int num = pinInterrupt(pin);
+  if (num < 0 || before == after) return;
+  int mode = gInterrupts[num].mode;
+  if (mode == CHANGE ||
+      (mode == FALLING && after == LOW) ||
+      (mode == RISING && after == HIGH)) {
+    fireInterrupt(num);
+  }
+}
+
+} // namespace
+
+// ========== NATIVE HAL ==========
+
+namespace NativeHAL {
+
+CostModel& costs() {
+  return gCosts;
+}
+
+uint64_t nowMicros() {
+  return gNow;
+}
+
+void advanceMicros(uint32_t us) {
+  uint64_t target = gNow + us;
+  if (gInEvents) {
+    // Called from inside an event callback: just move time, the outer
+    // loop picks up anything that became due
+    gNow = target;
+    return;
+  }
+
+  gInEvents = true;
+  while (!gEvents.empty() && gEvents.front().at <= target) {
+    std::pop_heap(gEvents.begin(), gEvents.end(), eventLater);
+    ScheduledEvent ev = gEvents.back();
+    gEvents.pop_back();
+    if (ev.at > gNow) gNow = ev.at;
+    ev.fn();
+    if (gNow > target) target = gNow;
+  }
+  gNow = target;
+  gInEvents = false;
+}
+
+void schedule(uint64_t atMicros, std::function<void()> fn) {
+  gEvents.push_back(ScheduledEvent{atMicros, gEventSeq++, fn});
+  std::push_heap(gEvents.begin(), gEvents.end(), eventLater);
+}
+
+void reset() {
+  gNow = 0;
+  gInEvents = false;
+  gEvents.clear();
+  for (uint8_t i = 0; i < NUM_DIGITAL_PINS; i++) {
+    gPins[i] = PinState();
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    gInterrupts[i] = InterruptSlot();
+  }
+  gInterruptsEnabled = true;
+  eepromResetInterrupt();
+  detachI2CDevices();
+  detachSPIDevices();
+  gSerialTxBusyUntil = 0;
+  gSerialInput.clear();
+  gSerialOutput.clear();
+  closeUART();
+}
+
+void setInput(uint8_t pin, uint8_t level) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  PinState& p = gPins[pin];
+  uint8_t before = pinLevel(p);
+  p.driven = level ? HIGH : LOW;
+  levelChanged(pin, before, pinLevel(p));
+}
+
+void releaseInput(uint8_t pin) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  PinState& p = gPins[pin];
+  uint8_t before = pinLevel(p);
+  p.driven = -1;
+  levelChanged(pin, before, pinLevel(p));
+}
+
+uint8_t outputLevel(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? gPins[pin].output : LOW;
+}
+
+uint64_t lastOutputChangeMicros(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? gPins[pin].lastChange : 0;
+}
+
+void pressButton(uint8_t pin, uint64_t atMicros, uint32_t holdMicros) {
+  schedule(atMicros, [pin]() { setInput(pin, LOW); });
+  schedule(atMicros + holdMicros, [pin]() { releaseInput(pin); });
+}
+
+void watchOutput(uint8_t pin, std::function<void(uint8_t level)> fn) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  gPins[pin].watchers.push_back(fn);
+}
+
+// ========== UART ==========
+
+void closeUART() {
+  if (gUart.master >= 0) close(gUart.master);
+  if (gUart.slave >= 0) close(gUart.slave);
+  gUart = UartPort();
+}
+
+void attachUARTDevice(std::function<void(uint8_t, uint32_t)> onByte) {
+  openUART();
+  gUart.device = onByte;
+}
+
+uint64_t uartByteMicros(uint32_t baud) {
+  return 10000000ULL / (baud ? baud : 115200);
+}
+
+uint64_t uartSend(const uint8_t* data, size_t length, uint32_t baud) {
+  if (!openUART()) return gNow;
+  uint64_t at = gUart.deviceBusyUntil > gNow ? gUart.deviceBusyUntil : gNow;
+  for (size_t i = 0; i < length; i++) {
+    at += uartByteMicros(baud);
+    uint8_t value = data[i];
+    schedule(at, [value, baud]() {
+      if (gUart.master >= 0 && baud == gUart.baud) {
+        ssize_t written = write(gUart.master, &value, 1);
+        (void)written;
+      }
+    });
+  }
+  gUart.deviceBusyUntil = at;
+  return at;
+}
+
+const char* uartPtyName() {
+  return gUart.slaveName.c_str();
+}
+
+void setSerialEcho(bool echo) {
+  gSerialEcho = echo;
+}
+
+void feedSerial(const char* text) {
+  while (text && *text) {
+    gSerialInput.push_back((uint8_t)*text++);
+  }
+}
+
+const std::string& serialOutput() {
+  return gSerialOutput;
+}
+
+void clearSerialOutput() {
+  gSerialOutput.clear();
+}
+
+LiquidCrystal* lcd() {
+  return gLCD;
+}
+
+void registerLCD(LiquidCrystal* display) {
+  gLCD = display;
+}
+
+uint64_t hostNanos() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace NativeHAL
+
+// ========== ARDUINO CORE API ==========
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  PinState& p = gPins[pin];
+  uint8_t before = pinLevel(p);
+  p.mode = mode;
+  levelChanged(pin, before, pinLevel(p));
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  NativeHAL::advanceMicros(gCosts.digitalWriteMicros);
+  if (pin >= NUM_DIGITAL_PINS) return;
+  PinState& p = gPins[pin];
+  uint8_t level = val ? HIGH : LOW;
+  if (p.output != level) {
+    p.output = level;
+    p.lastChange = gNow;
+    for (size_t i = 0; i < p.watchers.size(); i++) {
+      p.watchers[i](level);
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  NativeHAL::advanceMicros(gCosts.digitalReadMicros);
+  if (pin >= NUM_DIGITAL_PINS) return LOW;
+  return pinLevel(gPins[pin]);
+}
+
+unsigned long millis() {
+  return (unsigned long)(gNow / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)gNow;
+}
+
+void delay(unsigned long ms) {
+  NativeHAL::advanceMicros((uint32_t)(ms * 1000UL));
+}
+
+void delayMicroseconds(unsigned int us) {
+  NativeHAL::advanceMicros(us);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
+  if (interruptNum >= 2) return;
+  gInterrupts[interruptNum].handler = userFunc;
+  gInterrupts[interruptNum].mode = mode;
+  gInterrupts[interruptNum].pending = false;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum >= 2) return;
+  gInterrupts[interruptNum] = InterruptSlot();
+}
+
+void noInterrupts() {
+  gInterruptsEnabled = false;
+}
+
+void interrupts() {
+  gInterruptsEnabled = true;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (gInterrupts[i].pending) {
+      gInterrupts[i].pending = false;
+      fireInterrupt(i);
+    }
+  }
+}
+
+// ========== SERIAL ==========
+
+HardwareSerial Serial;
+HardwareSerial Serial1(1);
+TwoWire Wire;
+
+// Pull whatever the device has delivered to the pty into Serial1's buffer
+static std::deque<uint8_t>& serialInput(uint8_t port) {
+  if (port == 0) return gSerialInput;
+  uint8_t buffer[64];
+  ssize_t count;
+  while (gUart.slave >= 0 && (count = read(gUart.slave, buffer, sizeof(buffer))) > 0) {
+    gUart.input.insert(gUart.input.end(), buffer, buffer + count);
+  }
+  return gUart.input;
+}
+
+// 64-byte TX ring drained at 10 bits per byte: print() only blocks once
+// the ring is full, like HardwareSerial on the AVR core. Returns the time
+// the byte is out on the wire.
+static uint64_t queueTx(uint64_t& busyUntil, unsigned long baud) {
+  const uint64_t byteMicros = NativeHAL::uartByteMicros(baud);
+  const uint64_t ringMicros = 63 * byteMicros;
+  if (busyUntil > gNow + ringMicros) {
+    NativeHAL::advanceMicros((uint32_t)(busyUntil - gNow - ringMicros));
+  }
+  busyUntil = (busyUntil > gNow ? busyUntil : gNow) + byteMicros;
+  return busyUntil;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  if (_port == 0) {
+    gSerialBaud = baud ? baud : 115200;
+  } else {
+    openUART();
+    gUart.baud = baud ? baud : 115200;
+  }
+}
+
+int HardwareSerial::available() {
+  return (int)serialInput(_port).size();
+}
+
+int HardwareSerial::peek() {
+  std::deque<uint8_t>& input = serialInput(_port);
+  return input.empty() ? -1 : input.front();
+}
+
+int HardwareSerial::read() {
+  std::deque<uint8_t>& input = serialInput(_port);
+  if (input.empty()) return -1;
+  uint8_t c = input.front();
+  input.pop_front();
+  return c;
+}
+
+void HardwareSerial::flush() {
+  uint64_t busyUntil = _port == 0 ? gSerialTxBusyUntil : gUart.txBusyUntil;
+  if (busyUntil > gNow) {
+    NativeHAL::advanceMicros((uint32_t)(busyUntil - gNow));
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (_port != 0) {
+    if (gUart.slave < 0) return 0;
+    ssize_t written = ::write(gUart.slave, &c, 1);
+    if (written != 1) return 0;
+    uint32_t baud = gUart.baud;
+    NativeHAL::schedule(queueTx(gUart.txBusyUntil, baud), [baud]() {
+      uint8_t value;
+      if (gUart.master >= 0 && ::read(gUart.master, &value, 1) == 1 && gUart.device) {
+        gUart.device(value, baud);
+      }
+    });
+    return 1;
+  }
+
+  queueTx(gSerialTxBusyUntil, gSerialBaud);
+
+  // Keep the capture bounded for long benchmark runs
+  if (gSerialOutput.size() > (1u << 20)) {
+    gSerialOutput.erase(0, gSerialOutput.size() / 2);
+  }
+  gSerialOutput.push_back((char)c);
+  if (gSerialEcho) {
+    fputc(c, stdout);
+  }
+  return 1;
+}
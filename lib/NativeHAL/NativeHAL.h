@@ -0,0 +1,131 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+// Host-side hardware model for the native environment.
+//
+// Time is virtual: it only moves when the firmware calls delay()/
+// delayMicroseconds(), when a modelled peripheral access charges its
+// cost, or when the harness calls advanceMicros(). This makes loop cost
+// and tap-to-relay latency deterministic and comparable between runs.
+
+class LiquidCrystal;
+
+namespace NativeHAL {
+
+// Approximate costs on an ATmega328P @ 16 MHz, in microseconds
+struct CostModel {
+  uint32_t digitalReadMicros;     // digitalRead() incl. pin lookup
+  uint32_t digitalWriteMicros;    // digitalWrite() incl. pin lookup
+  uint32_t eepromReadMicros;      // EEPROM.read() once the EEPROM is idle
+  uint32_t eepromWriteMicros;     // Cell programming time after EEPROM.write()
+  uint32_t lcdByteMicros;         // LiquidCrystal send(): two nibbles + 100us settle
+  uint32_t lcdClearMicros;        // Extra delay inside LiquidCrystal::clear()/home()
+  uint32_t i2cTransactionMicros;  // Wire library overhead per transaction, on top of bus time
+  uint32_t spiTransferMicros;     // SPI.transfer() overhead per byte, on top of bus time
+  uint32_t pn532AckMicros;        // PN532 time to produce an ACK frame
+  uint32_t pn532ListMicros;       // InListPassiveTarget with a card in the field
+  uint32_t pn532AuthMicros;       // Mifare Classic authentication
+  uint32_t pn532ReadMicros;       // 16-byte READ
+  uint32_t pn532WriteMicros;      // Block/page WRITE incl. card EEPROM programming
+  uint32_t pn532RfByteMicros;     // Each reply byte past 16 in a FAST_READ, 106 kbps
+  uint32_t pn532NoAnswerMicros;   // Card command nobody answers: default non-DEP timeout
+  uint32_t pn532ActivationMicros; // One passive activation attempt with no card in the field
+};
+
+CostModel& costs();
+
+// ========== VIRTUAL CLOCK ==========
+
+uint64_t nowMicros();
+void advanceMicros(uint32_t us);
+
+// Run fn once the virtual clock reaches atMicros
+void schedule(uint64_t atMicros, std::function<void()> fn);
+
+// Reset clock, pins, scheduled events and serial buffers (EEPROM is kept)
+void reset();
+
+// ========== PINS ==========
+
+// Drive an input pin from outside (buttons, PN532 IRQ line).
+// Fires attached interrupts on matching edges.
+void setInput(uint8_t pin, uint8_t level);
+void releaseInput(uint8_t pin);
+
+uint8_t outputLevel(uint8_t pin);
+uint64_t lastOutputChangeMicros(uint8_t pin);
+
+// Convenience for active-LOW buttons on INPUT_PULLUP pins
+void pressButton(uint8_t pin, uint64_t atMicros, uint32_t holdMicros);
+
+// Call fn each time the firmware changes the level of an output pin
+// (bit-banged bus models). A pin can have several watchers, e.g. SCK
+// shared by two devices. Cleared by reset().
+void watchOutput(uint8_t pin, std::function<void(uint8_t level)> fn);
+
+// ========== I2C ==========
+
+// Device on the Wire bus: onWrite receives each write transaction,
+// onRead fills the bytes of each read transaction
+void attachI2CDevice(uint8_t address, std::function<void(const uint8_t*, uint8_t)> onWrite,
+                     std::function<void(uint8_t*, uint8_t)> onRead);
+void detachI2CDevices();  // Used by reset()
+
+// ========== SPI ==========
+
+// Device on the hardware SPI bus: exchange gets each MOSI byte, LSB
+// first, and returns the MISO byte. Chip select is the device's own
+// business (watchOutput() on its SS pin); a device that is not selected
+// returns 0xFF, as the bus ANDs the replies of every attached device.
+void attachSPIDevice(std::function<uint8_t(uint8_t)> exchange);
+void detachSPIDevices();  // Used by reset()
+
+// ========== UART ==========
+
+// Serial1 talks over a pseudo-terminal. Bytes the firmware writes reach
+// the attached device (with the baud rate they were sent at) once their
+// transmission time has passed on the virtual clock; bytes the device
+// sends with uartSend() turn up in Serial1 the same way, and only if
+// Serial1 runs at that baud rate.
+void attachUARTDevice(std::function<void(uint8_t, uint32_t)> onByte);
+uint64_t uartSend(const uint8_t* data, size_t length, uint32_t baud);  // Returns when the last byte is in
+uint64_t uartByteMicros(uint32_t baud);  // 10 bits: start, 8 data, stop
+const char* uartPtyName();               // Slave side, empty if no pty could be opened
+void closeUART();                        // Used by reset()
+
+// ========== SERIAL ==========
+
+void setSerialEcho(bool echo);
+void feedSerial(const char* text);
+const std::string& serialOutput();
+void clearSerialOutput();
+
+// ========== EEPROM ==========
+
+uint8_t* eepromData();
+uint32_t eepromWriteCount(uint16_t address);
+uint32_t eepromTotalWrites();
+void eepromFill(uint8_t value);
+
+// Stand-in for the EE_READY interrupt (EERIE): isr runs whenever the
+// EEPROM is idle while it is set. nullptr disables it.
+void eepromReadyInterrupt(void (*isr)());
+void eepromResetInterrupt();  // Used by reset()
+
+// ========== LCD ==========
+
+LiquidCrystal* lcd();
+void registerLCD(LiquidCrystal* display);
+
+// ========== HOST TIMING ==========
+
+// Wall-clock time on the host, for measuring real CPU cost of the loop
+uint64_t hostNanos();
+
+} // namespace NativeHAL
+
+#endif // NATIVE_HAL_H
@@ -0,0 +1,761 @@
+#include "NativePN532.h"
+#include "NativeHAL.h"
+#include "Arduino.h"
+#include <string.h>
+
+// ========== CARD FACTORIES ==========
+
+NativeCard NativeCard::classic1K(const uint8_t* uid4) {
+  NativeCard card;
+  memset(&card, 0, sizeof(card));
+  card.kind = MIFARE_CLASSIC_1K;
+  memcpy(card.uid, uid4, 4);
+  card.uidLength = 4;
+  card.atqa = 0x0004;
+  card.sak = 0x08;
+  card.memorySize = 1024;
+
+  // Manufacturer block: UID, BCC, SAK, ATQA
+  memcpy(card.memory, uid4, 4);
+  card.memory[4] = uid4[0] ^ uid4[1] ^ uid4[2] ^ uid4[3];
+  card.memory[5] = card.sak;
+  card.memory[6] = 0x04;
+  card.memory[7] = 0x00;
+
+  // Transport configuration: key A = key B = FF..FF
+  static const uint8_t trailer[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+  };
+  for (uint8_t sector = 0; sector < 16; sector++) {
+    memcpy(&card.memory[(sector * 4 + 3) * 16], trailer, 16);
+  }
+  return card;
+}
+
+static void initPagedCard(NativeCard& card, const uint8_t* uid7, uint16_t pages, uint8_t ccSize) {
+  memset(&card, 0, sizeof(card));
+  memcpy(card.uid, uid7, 7);
+  card.uidLength = 7;
+  card.atqa = 0x0044;
+  card.sak = 0x00;
+  card.memorySize = pages * 4;
+
+  // Pages 0-2: UID with check bytes, page 3: capability container
+  card.memory[0] = uid7[0];
+  card.memory[1] = uid7[1];
+  card.memory[2] = uid7[2];
+  card.memory[3] = 0x88 ^ uid7[0] ^ uid7[1] ^ uid7[2];
+  memcpy(&card.memory[4], &uid7[3], 4);
+  card.memory[8] = uid7[3] ^ uid7[4] ^ uid7[5] ^ uid7[6];
+  card.memory[12] = 0xE1;
+  card.memory[13] = 0x10;
+  card.memory[14] = ccSize;
+}
+
+NativeCard NativeCard::ultralight(const uint8_t* uid7) {
+  NativeCard card;
+  initPagedCard(card, uid7, 16, 0x06);
+  card.kind = MIFARE_ULTRALIGHT;
+  return card;
+}
+
+NativeCard NativeCard::ntag215(const uint8_t* uid7) {
+  NativeCard card;
+  initPagedCard(card, uid7, 135, 0x3E);
+  card.kind = NTAG215;
+  return card;
+}
+
+NativeCard NativeCard::iso14443_4(const uint8_t* uid, uint8_t uidLength) {
+  NativeCard card;
+  memset(&card, 0, sizeof(card));
+  card.kind = ISO14443_4;
+  memcpy(card.uid, uid, uidLength);
+  card.uidLength = uidLength;
+  card.atqa = uidLength == 7 ? 0x0344 : 0x0004;
+  card.sak = 0x20;
+
+  // DESFire EV1 ATS; phones send longer ones
+  static const uint8_t ats[] = {0x06, 0x75, 0x77, 0x81, 0x02, 0x80};
+  memcpy(card.ats, ats, sizeof(ats));
+  card.atsLength = sizeof(ats);
+  return card;
+}
+
+// ========== MODULE ==========
+
+// Bus protocol constants (PN532 user manual, section 6.2)
+static const uint8_t SPI_DATA_WRITE = 0x01;
+static const uint8_t SPI_STATUS_READ = 0x02;
+static const uint8_t SPI_DATA_READ = 0x03;
+static const uint8_t I2C_ADDRESS = 0x24;
+static const uint8_t HOST_TO_PN532 = 0xD4;
+static const uint8_t PN532_TO_HOST = 0xD5;
+
+static const uint8_t ACK_FRAME[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+static const uint8_t ERROR_FRAME[8] = {0x00, 0x00, 0xFF, 0x01, 0xFF, 0x7F, 0x81, 0x00};
+
+// InDataExchange status codes
+static const uint8_t STATUS_OK = 0x00;
+static const uint8_t STATUS_TIMEOUT = 0x01;
+static const uint8_t STATUS_AUTH_ERROR = 0x14;
+
+NativePN532& NativePN532::module() {
+  static NativePN532 instance;
+  return instance;
+}
+
+NativePN532::NativePN532() {
+  reset();
+}
+
+void NativePN532::reset() {
+  memset(&_card, 0, sizeof(_card));
+  _present = false;
+  _selected = false;
+  _irqPin = -1;
+  _authSector = -1;
+  _command.clear();
+  _generation = 0;
+  _executeAt = 0;
+  _waitingForCard = false;
+  _passiveRetries = 0xFF;
+  _field = false;
+  _fieldSince = 0;
+  _fieldTotal = 0;
+  _autoPolling = false;
+  _autoPollStart = 0;
+  _autoPollPeriod = 0;
+  _output.clear();
+  _outputReady = false;
+  _outputIsAck = false;
+  _spiMiso = 0;
+  _spiMosi = 0;
+  _spiSelected = false;
+  _spiRx.clear();
+  _hsu = false;
+  _hsuBaud = 115200;
+  _pendingBaud = 0;
+  _hsuRx.clear();
+  commands = 0;
+  authentications = 0;
+  reads = 0;
+  writes = 0;
+}
+
+void NativePN532::present(const NativeCard& card) {
+  _card = card;
+  _present = true;
+  _selected = false;
+  _authSector = -1;
+
+  // A pending InListPassiveTarget finishes once anticollision completes;
+  // InAutoPoll only notices the card at its next polling slot
+  if (_waitingForCard) {
+    _waitingForCard = false;
+    uint64_t at = NativeHAL::nowMicros();
+    if (_autoPolling) {
+      uint64_t slots = (at - _autoPollStart + _autoPollPeriod - 1) / _autoPollPeriod;
+      at = _autoPollStart + slots * _autoPollPeriod;
+    }
+    scheduleRespond(at + NativeHAL::costs().pn532ListMicros);
+  }
+}
+
+void NativePN532::scheduleRespond(uint64_t atMicros) {
+  uint32_t generation = _generation;
+  NativeHAL::schedule(atMicros, [this, generation]() {
+    if (generation == _generation) respond();
+  });
+}
+
+// ========== RF FIELD ==========
+
+void NativePN532::setField(bool on) {
+  uint64_t now = NativeHAL::nowMicros();
+  if (_field && !on) _fieldTotal += now - _fieldSince;
+  if (!_field && on) _fieldSince = now;
+  _field = on;
+}
+
+uint64_t NativePN532::fieldOnMicros() const {
+  uint64_t total = _fieldTotal;
+  if (_field) total += NativeHAL::nowMicros() - _fieldSince;
+  if (_autoPolling) {
+    total += ((NativeHAL::nowMicros() - _autoPollStart) / _autoPollPeriod + 1) * NativeHAL::costs().pn532ActivationMicros;
+  }
+  return total;
+}
+
+// InAutoPoll has the field on for one activation attempt per slot
+void NativePN532::endAutoPoll() {
+  if (!_autoPolling) return;
+  _fieldTotal += ((NativeHAL::nowMicros() - _autoPollStart) / _autoPollPeriod + 1) * NativeHAL::costs().pn532ActivationMicros;
+  _autoPolling = false;
+}
+
+void NativePN532::presentAt(uint64_t atMicros, const NativeCard& card) {
+  NativeHAL::schedule(atMicros, [this, card]() { present(card); });
+}
+
+void NativePN532::remove() {
+  _present = false;
+  _selected = false;
+  _authSector = -1;
+}
+
+void NativePN532::removeAt(uint64_t atMicros) {
+  NativeHAL::schedule(atMicros, [this]() { remove(); });
+}
+
+// ========== CARD OPERATIONS ==========
+
+bool NativePN532::listTarget(uint8_t* uid, uint8_t* uidLength) {
+  if (!_present) {
+    return false;
+  }
+  memcpy(uid, _card.uid, _card.uidLength);
+  *uidLength = _card.uidLength;
+  _selected = true;
+  _authSector = -1;
+  return true;
+}
+
+bool NativePN532::authenticate(uint8_t block, uint8_t keyType, const uint8_t* key,
+                               const uint8_t* uid, uint8_t uidLength) {
+  authentications++;
+  _authSector = -1;
+  if (!_present || !_selected || _card.kind != NativeCard::MIFARE_CLASSIC_1K) {
+    // No answer to the auth command; the card drops out of the protocol
+    _selected = false;
+    return false;
+  }
+
+  uint8_t compareLength = uidLength < 4 ? uidLength : 4;
+  const uint8_t* trailer = &_card.memory[((block / 4) * 4 + 3) * 16];
+  const uint8_t* expected = keyType == 0 ? trailer : trailer + 10;
+  if (memcmp(uid + uidLength - compareLength, _card.uid + _card.uidLength - compareLength, compareLength) != 0 ||
+      memcmp(key, expected, 6) != 0) {
+    _selected = false;
+    return false;
+  }
+
+  _authSector = block / 4;
+  return true;
+}
+
+bool NativePN532::readBlock(uint8_t block, uint8_t* data16) {
+  reads++;
+  if (!_present || !_selected) return false;
+
+  if (_card.kind == NativeCard::MIFARE_CLASSIC_1K) {
+    if (_authSector != block / 4 || block >= 64) {
+      _selected = false;
+      return false;
+    }
+    memcpy(data16, &_card.memory[block * 16], 16);
+    return true;
+  }
+
+  // Ultralight/NTAG READ returns four pages and rolls over at the end
+  uint16_t pages = _card.memorySize / 4;
+  if (block >= pages) return false;
+  for (uint8_t i = 0; i < 4; i++) {
+    uint16_t page = (block + i) % pages;
+    memcpy(&data16[i * 4], &_card.memory[page * 4], 4);
+  }
+  return true;
+}
+
+// NTAG21x only; an Ultralight does not know FAST_READ and drops out of
+// the selected state
+bool NativePN532::fastRead(uint8_t startPage, uint8_t endPage, uint8_t* data) {
+  reads++;
+  if (!_present || !_selected) return false;
+  if (_card.kind != NativeCard::NTAG215) {
+    _selected = false;
+    return false;
+  }
+  if (startPage > endPage || endPage >= _card.memorySize / 4) return false;
+  memcpy(data, &_card.memory[startPage * 4], (endPage - startPage + 1) * 4);
+  return true;
+}
+
+// NTAG21x GET_VERSION; an Ultralight NAKs it and drops out of the
+// selected state
+bool NativePN532::getVersion(uint8_t* version8) {
+  reads++;
+  if (!_present || !_selected) return false;
+  if (_card.kind != NativeCard::NTAG215) {
+    _selected = false;
+    return false;
+  }
+  static const uint8_t NTAG215_VERSION[8] = {0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x11, 0x03};
+  memcpy(version8, NTAG215_VERSION, 8);
+  return true;
+}
+
+bool NativePN532::writeBlock(uint8_t block, const uint8_t* data16) {
+  writes++;
+  if (!_present || !_selected || _card.kind != NativeCard::MIFARE_CLASSIC_1K) return false;
+  if (_authSector != block / 4 || block == 0 || block >= 64) {
+    _selected = false;
+    return false;
+  }
+  memcpy(&_card.memory[block * 16], data16, 16);
+  return true;
+}
+
+bool NativePN532::writePage(uint8_t page, const uint8_t* data4) {
+  writes++;
+  if (!_present || !_selected || _card.kind == NativeCard::MIFARE_CLASSIC_1K) return false;
+  if (page < 4 || page >= _card.memorySize / 4) return false;
+  memcpy(&_card.memory[page * 4], data4, 4);
+  return true;
+}
+
+// ========== COMMAND PROCESSING ==========
+
+// [00][00][FF][LEN][LCS][D4][command...][DCS][00], or an ACK to abort
+void NativePN532::receiveFrame(const uint8_t* frame, uint8_t length) {
+  uint8_t start = (length > 1 && frame[0] == 0x00 && frame[1] == 0xFF) ? 0 : 1;
+  if (length < start + 4 || frame[start] != 0x00 || frame[start + 1] != 0xFF) return;
+
+  uint8_t len = frame[start + 2];
+  if (len == 0x00 && frame[start + 3] == 0xFF) {
+    // The host's ACK after SetSerialBaudRate switches both ends
+    if (_pendingBaud) {
+      _hsuBaud = _pendingBaud;
+      _pendingBaud = 0;
+    }
+    abortCommand();
+    return;
+  }
+  uint8_t tfi = start + 4;
+  if ((uint8_t)(len + frame[start + 3]) != 0 || len < 2 || tfi + len >= length || frame[tfi] != HOST_TO_PN532) return;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i <= len; i++) sum += frame[tfi + i];
+  if (sum != 0) return;
+
+  // A new command replaces whatever was still running
+  abortCommand();
+  commands++;
+  _command.assign(frame + tfi + 1, frame + tfi + len);
+
+  uint32_t generation = _generation;
+  NativeHAL::schedule(NativeHAL::nowMicros() + NativeHAL::costs().pn532AckMicros, [this, generation]() {
+    if (generation != _generation) return;
+    _executeAt = NativeHAL::nowMicros() + commandMicros();
+    setOutput(ACK_FRAME, sizeof(ACK_FRAME), true);
+  });
+}
+
+void NativePN532::abortCommand() {
+  _generation++;
+  _command.clear();
+  _waitingForCard = false;
+  endAutoPoll();
+  if (_outputReady) {
+    _outputReady = false;
+    _output.clear();
+    setIrq(false);
+  }
+}
+
+uint32_t NativePN532::commandMicros() const {
+  const NativeHAL::CostModel& c = NativeHAL::costs();
+  if (_command.empty()) return 0;
+  if (_command[0] == 0x4A || _command[0] == 0x60) return c.pn532ListMicros;
+  if (_command[0] == 0x42) {
+    return _present && _card.kind != NativeCard::ISO14443_4 ? c.pn532ReadMicros : c.pn532NoAnswerMicros;
+  }
+  if (_command[0] != 0x40 || _command.size() < 3) return 0;
+  switch (_command[2]) {
+    case 0x60:
+    case 0x61:
+      // Only a Classic card answers; anything else leaves the PN532 waiting
+      return _present && _card.kind == NativeCard::MIFARE_CLASSIC_1K ? c.pn532AuthMicros : c.pn532NoAnswerMicros;
+    case 0x30: return c.pn532ReadMicros;
+    case 0x3A: {
+      uint8_t pages = _command.size() >= 5 && _command[4] >= _command[3] ? _command[4] - _command[3] + 1 : 0;
+      return c.pn532ReadMicros + (pages > 4 ? (pages - 4) * 4 * c.pn532RfByteMicros : 0);
+    }
+    case 0xA0:
+    case 0xA2: return c.pn532WriteMicros;
+    default:   return 0;
+  }
+}
+
+// Build the response frame for _command and flag it to the host
+void NativePN532::respond() {
+  if (_command.empty()) return;  // Already answered (card arrived before the retries ran out)
+  std::vector<uint8_t> reply;
+  _waitingForCard = false;
+  execute(reply);
+  if (_command.empty()) {
+    setOutput(ERROR_FRAME, sizeof(ERROR_FRAME), false);
+    return;
+  }
+
+  uint8_t frame[64];
+  uint8_t len = (uint8_t)(reply.size() + 2);
+  uint8_t sum = PN532_TO_HOST + (uint8_t)(_command[0] + 1);
+  frame[0] = 0x00;
+  frame[1] = 0x00;
+  frame[2] = 0xFF;
+  frame[3] = len;
+  frame[4] = (uint8_t)(~len + 1);
+  frame[5] = PN532_TO_HOST;
+  frame[6] = (uint8_t)(_command[0] + 1);
+  for (size_t i = 0; i < reply.size(); i++) {
+    frame[7 + i] = reply[i];
+    sum += reply[i];
+  }
+  frame[7 + reply.size()] = (uint8_t)(~sum + 1);
+  frame[8 + reply.size()] = 0x00;
+  _command.clear();
+  setOutput(frame, (uint8_t)(reply.size() + 9), false);
+}
+
+void NativePN532::execute(std::vector<uint8_t>& reply) {
+  if (_command.empty()) return;
+  switch (_command[0]) {
+    case 0x02:  // GetFirmwareVersion: PN532, firmware 1.6, ISO14443A/B + ISO18092
+      reply.push_back(0x32);
+      reply.push_back(0x01);
+      reply.push_back(0x06);
+      reply.push_back(0x07);
+      break;
+
+    case 0x10: {  // SetSerialBaudRate
+      static const uint32_t RATES[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1288000};
+      if (_command.size() < 2 || _command[1] >= sizeof(RATES) / sizeof(RATES[0])) {
+        _command.clear();
+        break;
+      }
+      _pendingBaud = RATES[_command[1]];
+      break;
+    }
+
+    case 0x14:  // SAMConfiguration
+      break;
+
+    case 0x32:  // RFConfiguration
+      if (_command.size() >= 3 && _command[1] == 0x01) setField(_command[2] & 0x01);
+      if (_command.size() >= 5 && _command[1] == 0x05) _passiveRetries = _command[4];
+      break;
+
+    case 0x60: {  // InAutoPoll, type A only: [NbTg][Type][Length][target data]
+      endAutoPoll();
+      uint8_t uid[7];
+      uint8_t uidLength;
+      if (!listTarget(uid, &uidLength)) {
+        reply.push_back(0);
+        break;
+      }
+      setField(true);
+      reply.push_back(1);
+      reply.push_back(0x10);
+      reply.push_back((uint8_t)(5 + uidLength + _card.atsLength));
+      reply.push_back(1);
+      reply.push_back((uint8_t)(_card.atqa >> 8));
+      reply.push_back((uint8_t)_card.atqa);
+      reply.push_back(_card.sak);
+      reply.push_back(uidLength);
+      reply.insert(reply.end(), uid, uid + uidLength);
+      reply.insert(reply.end(), _card.ats, _card.ats + _card.atsLength);
+      break;
+    }
+
+    case 0x4A: {  // InListPassiveTarget
+      uint8_t uid[7];
+      uint8_t uidLength;
+      if (!listTarget(uid, &uidLength)) {
+        reply.push_back(0);
+        break;
+      }
+      reply.push_back(1);
+      reply.push_back(1);
+      reply.push_back((uint8_t)(_card.atqa >> 8));
+      reply.push_back((uint8_t)_card.atqa);
+      reply.push_back(_card.sak);
+      reply.push_back(uidLength);
+      reply.insert(reply.end(), uid, uid + uidLength);
+      reply.insert(reply.end(), _card.ats, _card.ats + _card.atsLength);
+      break;
+    }
+
+    case 0x40:  // InDataExchange
+      dataExchange(reply);
+      break;
+
+    case 0x42:  // InCommunicateThru
+      communicateThru(reply);
+      break;
+
+    default:
+      _command.clear();  // Answered with a syntax error frame
+      break;
+  }
+}
+
+// [40][Tg][card command...] -> [status][card reply...]
+void NativePN532::dataExchange(std::vector<uint8_t>& reply) {
+  const std::vector<uint8_t>& c = _command;
+  if (c.size() < 4) {
+    reply.push_back(STATUS_TIMEOUT);
+    return;
+  }
+
+  uint8_t block = c[3];
+  uint8_t data[16];
+  switch (c[2]) {
+    case 0x60:
+    case 0x61:
+      if (c.size() < 10 + 4) break;
+      reply.push_back(authenticate(block, c[2] - 0x60, &c[4], &c[10], (uint8_t)(c.size() - 10))
+                      ? STATUS_OK : STATUS_AUTH_ERROR);
+      return;
+
+    case 0x30:
+      if (!readBlock(block, data)) break;
+      reply.push_back(STATUS_OK);
+      reply.insert(reply.end(), data, data + 16);
+      return;
+
+    case 0x3A: {
+      uint8_t pages[64];
+      if (c.size() < 5 || c[4] < block || c[4] - block >= 12 || !fastRead(block, c[4], pages)) break;
+      reply.push_back(STATUS_OK);
+      reply.insert(reply.end(), pages, pages + (c[4] - block + 1) * 4);
+      return;
+    }
+
+    case 0xA0:
+      if (c.size() < 4 + 16 || !writeBlock(block, &c[4])) break;
+      reply.push_back(STATUS_OK);
+      return;
+
+    case 0xA2:
+      if (c.size() < 4 + 4 || !writePage(block, &c[4])) break;
+      reply.push_back(STATUS_OK);
+      return;
+  }
+  reply.push_back(STATUS_TIMEOUT);  // The card did not answer
+}
+
+// [42][card command...] -> [status][card reply...]
+void NativePN532::communicateThru(std::vector<uint8_t>& reply) {
+  const std::vector<uint8_t>& c = _command;
+  uint8_t version[8];
+  if (c.size() == 2 && c[1] == 0x60 && getVersion(version)) {
+    reply.push_back(STATUS_OK);
+    reply.insert(reply.end(), version, version + 8);
+    return;
+  }
+  reply.push_back(STATUS_TIMEOUT);
+}
+
+void NativePN532::setOutput(const uint8_t* data, uint8_t length, bool ack) {
+  _output.assign(data, data + length);
+  _outputIsAck = ack;
+  _outputReady = true;
+  setIrq(true);
+  if (_hsu) hsuTransmit();
+}
+
+// The host has read the frame: after the ACK, run the command
+void NativePN532::consumeOutput() {
+  bool wasAck = _outputIsAck;
+  _outputReady = false;
+  _output.clear();
+  setIrq(false);
+  if (!wasAck || _command.empty()) return;
+
+  // With MxRtyPassiveActivation at its default the PN532 keeps
+  // searching until a card shows up; otherwise it gives up after the
+  // retries. InListPassiveTarget leaves the field on either way.
+  if (_command[0] == 0x4A) {
+    setField(true);
+    if (!_present) {
+      _waitingForCard = true;
+      if (_passiveRetries != 0xFF) {
+        scheduleRespond(NativeHAL::nowMicros() + (_passiveRetries + 1) * NativeHAL::costs().pn532ActivationMicros);
+      }
+      return;
+    }
+  }
+
+  // InAutoPoll switches the field off and polls once per period
+  if (_command[0] == 0x60 && _command.size() >= 4 && !_present) {
+    setField(false);
+    _autoPolling = true;
+    _autoPollStart = NativeHAL::nowMicros();
+    _autoPollPeriod = (_command[2] ? _command[2] : 1) * 150000U;
+    _waitingForCard = true;
+    if (_command[1] != 0xFF) {
+      scheduleRespond(_autoPollStart + _command[1] * (uint64_t)_autoPollPeriod);
+    }
+    return;
+  }
+
+  uint64_t now = NativeHAL::nowMicros();
+  uint32_t generation = _generation;
+  NativeHAL::schedule(_executeAt > now ? _executeAt : now, [this, generation]() {
+    if (generation == _generation) respond();
+  });
+}
+
+// ========== SPI SLAVE ==========
+
+void NativePN532::attachSPI(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss) {
+  _spiMiso = miso;
+  _spiMosi = mosi;
+  NativeHAL::watchOutput(ss, [this](uint8_t level) { spiSelect(level); });
+  NativeHAL::watchOutput(sck, [this](uint8_t level) { spiClock(level); });
+  NativeHAL::attachSPIDevice([this](uint8_t in) { return spiExchange(in); });
+}
+
+void NativePN532::spiSelect(uint8_t level) {
+  if (level == LOW) {
+    _spiSelected = true;
+    _spiBit = 0;
+    _spiIn = 0;
+    _spiOut = 0;
+    _spiOp = 0;
+    _spiBytes = 0;
+    _spiReadIndex = 0;
+    _spiRx.clear();
+    NativeHAL::setInput(_spiMiso, LOW);
+  } else if (_spiSelected) {
+    _spiSelected = false;
+    spiEnd();
+  }
+}
+
+// Mode 0, LSB first: sample MOSI on the rising edge, shift MISO on the falling one
+void NativePN532::spiClock(uint8_t level) {
+  if (!_spiSelected) return;
+  if (level == HIGH) {
+    if (NativeHAL::outputLevel(_spiMosi)) {
+      _spiIn |= (uint8_t)(1 << _spiBit);
+    }
+    if (++_spiBit == 8) {
+      spiByte(_spiIn);
+      _spiBit = 0;
+      _spiIn = 0;
+    }
+  } else {
+    NativeHAL::setInput(_spiMiso, (_spiOut >> _spiBit) & 0x01);
+  }
+}
+
+// Hardware SPI: a whole byte per SPI.transfer()
+uint8_t NativePN532::spiExchange(uint8_t in) {
+  if (!_spiSelected) return 0xFF;
+  uint8_t out = _spiOut;
+  spiByte(in);
+  return out;
+}
+
+// The first byte selects the operation; pick the next byte to shift out
+void NativePN532::spiByte(uint8_t in) {
+  if (_spiBytes++ == 0) {
+    _spiOp = in;
+  } else if (_spiOp == SPI_DATA_WRITE) {
+    _spiRx.push_back(in);
+  }
+
+  if (_spiOp == SPI_STATUS_READ) {
+    _spiOut = _outputReady ? 0x01 : 0x00;
+  } else if (_spiOp == SPI_DATA_READ && _outputReady && _spiReadIndex < _output.size()) {
+    _spiOut = _output[_spiReadIndex++];
+  } else {
+    _spiOut = 0x00;
+  }
+}
+
+void NativePN532::spiEnd() {
+  if (_spiOp == SPI_DATA_WRITE) {
+    receiveFrame(_spiRx.data(), (uint8_t)_spiRx.size());
+  } else if (_spiOp == SPI_DATA_READ && _spiReadIndex > 0 && _outputReady) {
+    consumeOutput();
+  }
+}
+
+// ========== I2C SLAVE ==========
+
+void NativePN532::attachI2C() {
+  NativeHAL::attachI2CDevice(I2C_ADDRESS,
+    [this](const uint8_t* data, uint8_t length) { i2cWrite(data, length); },
+    [this](uint8_t* data, uint8_t length) { i2cRead(data, length); });
+}
+
+void NativePN532::i2cWrite(const uint8_t* data, uint8_t length) {
+  receiveFrame(data, length);
+}
+
+// Every read starts with the status byte; a longer read takes the frame
+void NativePN532::i2cRead(uint8_t* data, uint8_t length) {
+  memset(data, 0, length);
+  if (length == 0) return;
+  data[0] = _outputReady ? 0x01 : 0x00;
+  if (!_outputReady || length == 1) return;
+
+  for (uint8_t i = 1; i < length && i <= _output.size(); i++) {
+    data[i] = _output[i - 1];
+  }
+  consumeOutput();
+}
+
+void NativePN532::setIrq(bool asserted) {
+  if (_irqPin < 0) return;
+  // The PN532 IRQ line is active LOW
+  NativeHAL::setInput((uint8_t)_irqPin, asserted ? LOW : HIGH);
+}
+
+// ========== HSU ==========
+
+void NativePN532::attachHSU() {
+  _hsu = true;
+  NativeHAL::attachUARTDevice([this](uint8_t in, uint32_t baud) { hsuByte(in, baud); });
+}
+
+// The wakeup preamble (55 55 00 ...) and anything else outside a frame
+// is skipped until a 00 FF start code; a frame is complete at its DCS
+void NativePN532::hsuByte(uint8_t in, uint32_t baud) {
+  if (baud != _hsuBaud) {
+    _hsuRx.clear();  // Framing errors at the wrong rate
+    return;
+  }
+  _hsuRx.push_back(in);
+  if (_hsuRx.size() == 1) {
+    if (in != 0x00) _hsuRx.clear();
+    return;
+  }
+  if (_hsuRx.size() == 2) {
+    if (in != 0xFF) {
+      _hsuRx.clear();
+      if (in == 0x00) _hsuRx.push_back(in);
+    }
+    return;
+  }
+  if (_hsuRx.size() < 4) return;
+
+  bool ack = _hsuRx[2] == 0x00 && _hsuRx[3] == 0xFF;
+  size_t length = ack ? 4 : _hsuRx[2] + 5;
+  if (_hsuRx.size() < length) return;
+  receiveFrame(_hsuRx.data(), (uint8_t)length);
+  _hsuRx.clear();
+}
+
+// No status byte or reads on HSU: the frame goes straight out and the
+// PN532 carries on once it has been sent
+void NativePN532::hsuTransmit() {
+  uint64_t sent = NativeHAL::uartSend(_output.data(), _output.size(), _hsuBaud);
+  uint32_t generation = _generation;
+  NativeHAL::schedule(sent, [this, generation]() {
+    if (generation == _generation && _outputReady) consumeOutput();
+  });
+}
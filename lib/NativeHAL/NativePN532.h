@@ -0,0 +1,156 @@
+#ifndef NATIVE_PN532_H
+#define NATIVE_PN532_H
+
+#include <stdint.h>
+#include <vector>
+
+// A tag that can be placed in the reader's RF field
+struct NativeCard {
+  enum Kind {
+    MIFARE_CLASSIC_1K,
+    MIFARE_ULTRALIGHT,
+    NTAG215,
+    ISO14443_4   // DESFire, or a phone emulating a card: no Classic or page commands
+  };
+
+  Kind kind;
+  uint8_t uid[7];
+  uint8_t uidLength;
+  uint16_t atqa;
+  uint8_t sak;
+  uint8_t ats[20];        // ISO14443-4 answer to select, TL byte first; sent after the UID
+  uint8_t atsLength;
+  uint8_t memory[1024];   // Classic: 64 blocks x 16 bytes, Ultralight/NTAG: pages x 4 bytes
+  uint16_t memorySize;
+
+  static NativeCard classic1K(const uint8_t* uid4);
+  static NativeCard ultralight(const uint8_t* uid7);
+  static NativeCard ntag215(const uint8_t* uid7);
+  static NativeCard iso14443_4(const uint8_t* uid, uint8_t uidLength);
+};
+
+// Model of the PN532 module and its antenna field. The firmware's own
+// driver talks to it over the bus: SPI on the pins given to attachSPI()
+// (bit-banged or through the SPI stand-in), I2C through the Wire
+// stand-in, or HSU on Serial1's pseudo-terminal after attachHSU().
+// Command frames are ACKed after pn532AckMicros, executed against the
+// card in the field once the ACK has been read, and the response is
+// flagged through the status byte and the IRQ line (sent straight away
+// over HSU). module() is the default instance; further modules (a second
+// reader) need their own SS and IRQ pins.
+class NativePN532 {
+public:
+  NativePN532();
+  static NativePN532& module();
+
+  void reset();
+  void setIrqPin(int8_t pin) { _irqPin = pin; }
+  int8_t irqPin() const { return _irqPin; }
+
+  // ===== Host interface =====
+  void attachSPI(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss);
+  void attachI2C();
+  void attachHSU();  // Frames are sent unasked; don't combine with SPI/I2C
+  uint32_t hsuBaud() const { return _hsuBaud; }
+
+  // ===== Field control (harness side) =====
+  void present(const NativeCard& card);
+  void presentAt(uint64_t atMicros, const NativeCard& card);
+  void remove();
+  void removeAt(uint64_t atMicros);
+  bool hasCard() const { return _present; }
+  NativeCard& card() { return _card; }
+
+  // ===== Card operations =====
+  bool listTarget(uint8_t* uid, uint8_t* uidLength);
+  bool authenticate(uint8_t block, uint8_t keyType, const uint8_t* key, const uint8_t* uid, uint8_t uidLength);
+  bool readBlock(uint8_t block, uint8_t* data16);
+  bool fastRead(uint8_t startPage, uint8_t endPage, uint8_t* data);
+  bool getVersion(uint8_t* version8);
+  bool writeBlock(uint8_t block, const uint8_t* data16);
+  bool writePage(uint8_t page, const uint8_t* data4);
+
+  // ===== Counters =====
+  uint32_t commands;
+  uint32_t authentications;
+  uint32_t reads;
+  uint32_t writes;
+
+  // ===== RF field =====
+  bool fieldOn() const { return _field; }
+  uint64_t fieldOnMicros() const;  // Total time the field has been on
+
+private:
+  NativeCard _card;
+  bool _present;
+  bool _selected;
+  int8_t _irqPin;
+  int16_t _authSector;
+
+  // Command in progress; scheduled steps only run if _generation still matches
+  std::vector<uint8_t> _command;
+  uint32_t _generation;
+  uint64_t _executeAt;
+  bool _waitingForCard;
+
+  // RF field and polling
+  uint8_t _passiveRetries;
+  bool _field;
+  uint64_t _fieldSince;
+  uint64_t _fieldTotal;
+  bool _autoPolling;
+  uint64_t _autoPollStart;
+  uint32_t _autoPollPeriod;
+
+  // Frame waiting to be read by the host
+  std::vector<uint8_t> _output;
+  bool _outputReady;
+  bool _outputIsAck;
+
+  // SPI slave state
+  uint8_t _spiMiso;
+  uint8_t _spiMosi;
+  bool _spiSelected;
+  uint8_t _spiBit;
+  uint8_t _spiIn;
+  uint8_t _spiOut;
+  uint8_t _spiOp;
+  uint8_t _spiBytes;
+  uint8_t _spiReadIndex;
+  std::vector<uint8_t> _spiRx;
+
+  // HSU state
+  bool _hsu;
+  uint32_t _hsuBaud;
+  uint32_t _pendingBaud;        // SetSerialBaudRate, applied on the host's ACK
+  std::vector<uint8_t> _hsuRx;
+
+  void receiveFrame(const uint8_t* frame, uint8_t length);
+  void abortCommand();
+  uint32_t commandMicros() const;
+  void respond();
+  void execute(std::vector<uint8_t>& reply);
+  void dataExchange(std::vector<uint8_t>& reply);
+  void communicateThru(std::vector<uint8_t>& reply);
+  void setOutput(const uint8_t* data, uint8_t length, bool ack);
+  void consumeOutput();
+  void setField(bool on);
+  void endAutoPoll();
+  void scheduleRespond(uint64_t atMicros);
+
+  void spiSelect(uint8_t level);
+  void spiClock(uint8_t level);
+  void spiByte(uint8_t in);
+  uint8_t spiExchange(uint8_t in);
+  void spiEnd();
+
+  void i2cWrite(const uint8_t* data, uint8_t length);
+  void i2cRead(uint8_t* data, uint8_t length);
+
+  void hsuByte(uint8_t in, uint32_t baud);
+  void hsuTransmit();
+
+  void setIrq(bool asserted);
+};
+
+#endif // NATIVE_PN532_H
@@ -0,0 +1,96 @@
+#include "Print.h"
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  if (!str) return 0;
+  return write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::printNumber(unsigned long value, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+
+  if (base < 2) base = 10;
+  do {
+    char digit = value % base;
+    value /= base;
+    *--str = digit < 10 ? digit + '0' : digit + 'A' - 10;
+  } while (value);
+
+  return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper* str) {
+  return write(reinterpret_cast<const char*>(str));
+}
+
+size_t Print::print(const String& str) {
+  return write(str.c_str());
+}
+
+size_t Print::print(const char* str) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  if (base == 10 && value < 0) {
+    size_t n = print('-');
+    return n + printNumber((unsigned long)(-value), 10);
+  }
+  if (base != 10) {
+    // Match AVR behaviour: negative values print as their 32-bit pattern
+    return printNumber((unsigned long)(uint32_t)value, base);
+  }
+  return printNumber((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, value);
+  return write(buf);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper* str) { size_t n = print(str); return n + println(); }
+size_t Print::println(const String& str) { size_t n = print(str); return n + println(); }
+size_t Print::println(const char* str) { size_t n = print(str); return n + println(); }
+size_t Print::println(char c) { size_t n = print(c); return n + println(); }
+size_t Print::println(unsigned char value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(int value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned int value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(long value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned long value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(double value, int digits) { size_t n = print(value, digits); return n + println(); }
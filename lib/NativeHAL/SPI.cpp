@@ -0,0 +1,60 @@
+#include "SPI.h"
+#include "NativeHAL.h"
+
+#include <vector>
+
+namespace {
+
+const uint32_t CPU_CLOCK = 16000000;
+
+std::vector<std::function<uint8_t(uint8_t)>> gDevices;
+
+// The device sees bits in wire order, LSB first
+uint8_t reverseBits(uint8_t value) {
+  uint8_t out = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    out = (uint8_t)((out << 1) | ((value >> i) & 0x01));
+  }
+  return out;
+}
+
+} // namespace
+
+namespace NativeHAL {
+
+void attachSPIDevice(std::function<uint8_t(uint8_t)> exchange) {
+  gDevices.push_back(exchange);
+}
+
+void detachSPIDevices() {
+  gDevices.clear();
+}
+
+} // namespace NativeHAL
+
+SPIClass SPI;
+
+void SPIClass::begin() {
+  _clock = 4000000;
+  _bitOrder = MSBFIRST;
+}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+  uint32_t divider = 2;
+  while (divider < 128 && CPU_CLOCK / divider > settings.clock) {
+    divider *= 2;
+  }
+  _clock = CPU_CLOCK / divider;
+  _bitOrder = settings.bitOrder;
+}
+
+// Eight clocks on the bus plus the SPDR write and SPIF wait around them
+uint8_t SPIClass::transfer(uint8_t data) {
+  NativeHAL::advanceMicros((8000000 + _clock - 1) / _clock + NativeHAL::costs().spiTransferMicros);
+  uint8_t out = _bitOrder == MSBFIRST ? reverseBits(data) : data;
+  uint8_t in = 0xFF;
+  for (size_t i = 0; i < gDevices.size(); i++) {
+    in &= gDevices[i](out);
+  }
+  return _bitOrder == MSBFIRST ? reverseBits(in) : in;
+}
@@ -0,0 +1,45 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+// Clock, bit order and mode for a transaction. As on the AVR, the clock
+// is rounded down to F_CPU / 2^n (16 MHz / 2 .. 128).
+class SPISettings {
+public:
+  SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+    : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+};
+
+// Host stand-in for the AVR SPI library. Bytes go to the device
+// registered with NativeHAL::attachSPIDevice() in wire order and are
+// charged to the virtual clock at the effective bus speed.
+class SPIClass {
+public:
+  void begin();
+  void end() {}
+
+  void beginTransaction(SPISettings settings);
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data);
+
+  uint32_t clock() const { return _clock; }  // Effective clock of the last transaction
+
+private:
+  uint32_t _clock = 4000000;
+  uint8_t _bitOrder = MSBFIRST;
+};
+
+extern SPIClass SPI;
+
+#endif // NATIVE_SPI_H
@@ -0,0 +1,35 @@
+#include "WString.h"
+#include <stdio.h>
+
+static std::string formatNumber(unsigned long value, unsigned char base, bool negative) {
+  char buf[8 * sizeof(long) + 2];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+
+  if (base < 2) base = 10;
+  do {
+    char digit = value % base;
+    value /= base;
+    *--str = digit < 10 ? digit + '0' : digit + 'a' - 10;
+  } while (value);
+
+  if (negative) *--str = '-';
+  return std::string(str);
+}
+
+String::String(unsigned char value, unsigned char base)
+  : _str(formatNumber(value, base, false)) {}
+
+String::String(int value, unsigned char base)
+  : _str(base == 10 && value < 0 ? formatNumber((unsigned long)(-(long)value), 10, true)
+                                 : formatNumber((unsigned long)(unsigned int)value, base, false)) {}
+
+String::String(unsigned int value, unsigned char base)
+  : _str(formatNumber(value, base, false)) {}
+
+String::String(long value, unsigned char base)
+  : _str(base == 10 && value < 0 ? formatNumber((unsigned long)(-value), 10, true)
+                                 : formatNumber((unsigned long)value, base, false)) {}
+
+String::String(unsigned long value, unsigned char base)
+  : _str(formatNumber(value, base, false)) {}
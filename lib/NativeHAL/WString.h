@@ -0,0 +1,49 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+
+// Minimal Arduino String backed by std::string
+class String {
+public:
+  String() {}
+  String(const char* str) : _str(str ? str : "") {}
+  String(const __FlashStringHelper* str) : _str(reinterpret_cast<const char*>(str)) {}
+  String(const std::string& str) : _str(str) {}
+  explicit String(char c) : _str(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+
+  unsigned int length() const { return (unsigned int)_str.length(); }
+  const char* c_str() const { return _str.c_str(); }
+  char charAt(unsigned int index) const { return index < _str.length() ? _str[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  bool concat(const String& other) { _str += other._str; return true; }
+  bool concat(const char* str) { if (str) _str += str; return true; }
+  bool concat(char c) { _str += c; return true; }
+  String& operator+=(const String& other) { concat(other); return *this; }
+  String& operator+=(const char* str) { concat(str); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+
+  bool equals(const String& other) const { return _str == other._str; }
+  bool operator==(const String& other) const { return _str == other._str; }
+  bool operator==(const char* str) const { return _str == (str ? str : ""); }
+  bool operator!=(const String& other) const { return _str != other._str; }
+  bool operator!=(const char* str) const { return !(*this == str); }
+
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs._str + rhs._str); }
+  friend String operator+(const String& lhs, const char* rhs) { return String(lhs._str + (rhs ? rhs : "")); }
+  friend String operator+(const char* lhs, const String& rhs) { return String((lhs ? lhs : "") + rhs._str); }
+
+private:
+  std::string _str;
+};
+
+#endif // NATIVE_WSTRING_H
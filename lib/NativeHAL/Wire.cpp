@@ -0,0 +1,99 @@
+#include "Wire.h"
+#include "NativeHAL.h"
+
+#include <map>
+
+namespace {
+
+struct I2CDevice {
+  std::function<void(const uint8_t*, uint8_t)> onWrite;
+  std::function<void(uint8_t*, uint8_t)> onRead;
+};
+
+std::map<uint8_t, I2CDevice> gDevices;
+
+} // namespace
+
+namespace NativeHAL {
+
+void attachI2CDevice(uint8_t address, std::function<void(const uint8_t*, uint8_t)> onWrite,
+                     std::function<void(uint8_t*, uint8_t)> onRead) {
+  gDevices[address] = I2CDevice{onWrite, onRead};
+}
+
+void detachI2CDevices() {
+  gDevices.clear();
+}
+
+} // namespace NativeHAL
+
+void TwoWire::begin() {
+  _txLength = 0;
+  _rxLength = 0;
+  _rxIndex = 0;
+}
+
+void TwoWire::setClock(uint32_t clock) {
+  _clock = clock ? clock : 100000;
+}
+
+// Address byte plus data, 9 clocks each, and the start/stop conditions
+void TwoWire::charge(uint8_t bytes) {
+  uint64_t bits = (uint64_t)(bytes + 1) * 9 + 2;
+  NativeHAL::advanceMicros((uint32_t)(bits * 1000000ULL / _clock) + NativeHAL::costs().i2cTransactionMicros);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _address = address;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (_txLength >= BUFFER_LENGTH) return 0;
+  _txBuffer[_txLength++] = value;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+  size_t written = 0;
+  while (written < length && write(data[written])) {
+    written++;
+  }
+  return written;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  std::map<uint8_t, I2CDevice>::iterator it = gDevices.find(_address);
+  if (it == gDevices.end()) {
+    charge(0);
+    return 2;  // Address NACK
+  }
+  charge(_txLength);
+  it->second.onWrite(_txBuffer, _txLength);
+  _txLength = 0;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool) {
+  _rxIndex = 0;
+  _rxLength = 0;
+  if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+
+  std::map<uint8_t, I2CDevice>::iterator it = gDevices.find(address);
+  if (it == gDevices.end()) {
+    charge(0);
+    return 0;
+  }
+  charge(quantity);
+  it->second.onRead(_rxBuffer, quantity);
+  _rxLength = quantity;
+  return quantity;
+}
+
+int TwoWire::available() {
+  return _rxLength - _rxIndex;
+}
+
+int TwoWire::read() {
+  return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1;
+}
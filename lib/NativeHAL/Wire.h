@@ -0,0 +1,40 @@
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include "Arduino.h"
+
+// Host stand-in for the AVR Wire library. Transactions go to devices
+// registered with NativeHAL::attachI2CDevice() and are charged to the
+// virtual clock at the configured bus speed.
+class TwoWire {
+public:
+  static const uint8_t BUFFER_LENGTH = 32;  // Same limit as the AVR core
+
+  void begin();
+  void end() {}
+  void setClock(uint32_t clock);
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t* data, size_t length);
+  uint8_t endTransmission(bool sendStop = true);
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+  int available();
+  int read();
+
+private:
+  uint32_t _clock = 100000;
+  uint8_t _address = 0;
+  uint8_t _txBuffer[BUFFER_LENGTH];
+  uint8_t _txLength = 0;
+  uint8_t _rxBuffer[BUFFER_LENGTH];
+  uint8_t _rxLength = 0;
+  uint8_t _rxIndex = 0;
+
+  void charge(uint8_t bytes);
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
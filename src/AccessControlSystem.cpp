@@ -16,8 +16,8 @@ const char STR_CLEAR_ALL[] PROGMEM = "Clear All";
 const char STR_EXIT[] PROGMEM = "Exit Menu";
 
 AccessControlSystem::AccessControlSystem(NFCReader& nfcReader)
-  : _nfc(nfcReader),
-    _lcd(LCD_RS, LCD_EN, LCD_D4, LCD_D5, LCD_D6, LCD_D7),
+  : _lcd(LCD_RS, LCD_EN, LCD_D4, LCD_D5, LCD_D6, LCD_D7),
+    _display(_lcd),
     _currentState(SystemState::IDLE),
     _lastDisplayState(SystemState::IDLE),
     _currentMenuItem(MenuItem::REGISTER_CARD),
@@ -29,8 +29,6 @@ AccessControlSystem::AccessControlSystem(NFCReader& nfcReader)
     _lastDisplayUpdate(0),
     _relayActive(false),
     _displayNeedsUpdate(true),
-    _cachedCardCount(0),
-    _cardCountCacheValid(false),
     _listCardIndex(0),
     _btnUpPressed(false),
     _btnDownPressed(false),
@@ -48,8 +46,11 @@ AccessControlSystem::AccessControlSystem(NFCReader& nfcReader)
     _btnUpStable(false),
     _btnDownStable(false),
     _btnSelectStable(false),
-    _btnBackStable(false)
+    _btnBackStable(false),
+    _messageDuration(0),
+    _messageNextState(SystemState::IDLE)
 {
+  _readers.add(nfcReader);
 }
 
 bool AccessControlSystem::begin() {
@@ -59,21 +60,23 @@ bool AccessControlSystem::begin() {
   // Initialize LCD
   Serial.print(F("LCD: "));
   _lcd.begin(LCD_COLS, LCD_ROWS);
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print(F("Access Control"));
-  _lcd.setCursor(0, 1);
-  _lcd.print(F("Initializing..."));
+  _display.begin();
+  _display.setCursor(0, 0);
+  _display.print(F("Access Control"));
+  _display.setCursor(0, 1);
+  _display.print(F("Initializing..."));
+  _display.flush();
   Serial.println(F("OK"));
   
   // Initialize NFC Reader
   Serial.print(F("NFC: "));
-  if (!_nfc.begin()) {
+  if (!_readers.begin()) {
     Serial.println(F("FAILED!"));
-    _lcd.clear();
-    _lcd.print(F("NFC ERROR!"));
-    _lcd.setCursor(0, 1);
-    _lcd.print(F("Check wiring"));
+    _display.clear();
+    _display.print(F("NFC ERROR!"));
+    _display.setCursor(0, 1);
+    _display.print(F("Check wiring"));
+    _display.flush();
     return false;
   }
   Serial.println(F("OK"));
@@ -93,6 +96,7 @@ bool AccessControlSystem::begin() {
   
   setState(SystemState::IDLE);
   updateDisplay(); // Force initial display update
+  _display.flush();
   
   Serial.println(F("\n=== System Ready ==="));
   Serial.println(F("Scan card or long-press SELECT for menu\n"));
@@ -112,36 +116,56 @@ void AccessControlSystem::initRelay() {
 }
 
 void AccessControlSystem::initEEPROM() {
-  // Check if EEPROM is initialized
-  uint16_t magic = (EEPROM.read(EEPROM_MAGIC_ADDR) << 8) | EEPROM.read(EEPROM_MAGIC_ADDR + 1);
-  
-  if (magic != EEPROM_MAGIC_NUMBER) {
-    // First time - initialize EEPROM
-    EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_NUMBER >> 8);
-    EEPROM.write(EEPROM_MAGIC_ADDR + 1, EEPROM_MAGIC_NUMBER & 0xFF);
-    saveCardCount(0);
-  }
-  
-  // Load card count into cache
-  _cachedCardCount = EEPROM.read(EEPROM_CARD_COUNT_ADDR);
-  _cardCountCacheValid = true;
+  // Load the card log and build the RAM index
+  _cards.begin();
 }
 
 // ========== MAIN UPDATE LOOP ==========
 
 void AccessControlSystem::update() {
+  LOOP_PROFILE_START();
   updateButtons();
+  LOOP_PROFILE_PHASE(LoopPhase::BUTTONS);
   updateRelay();
+  LOOP_PROFILE_PHASE(LoopPhase::RELAY);
   checkStateTimeout();
+  LOOP_PROFILE_PHASE(LoopPhase::TIMEOUTS);
   
-  // Read NFC card
-  NFCCardInfo cardInfo = _nfc.readCard();
+  // Read NFC card; while idle, have a Classic card reported on its
+  // physical UID before the custom sector is read
+  NFCCardInfo cardInfo = _readers.readCard(FAST_GRANT_PHYSICAL_UID && _currentState == SystemState::IDLE);
+  LOOP_PROFILE_PHASE(LoopPhase::NFC);
   
   // Handle card based on current state
   switch (_currentState) {
     case SystemState::IDLE:
       if (cardInfo.detected) {
+        // Decide and switch the relay before any logging. A registered
+        // physical UID grants whether or not a cloned UID is cached.
+        bool authorized = isCardAuthorized(cardInfo);
+        if (!authorized && FAST_GRANT_PHYSICAL_UID && cardInfo.hasClonedUID) {
+          authorized = _cards.contains(cardInfo.uid, cardInfo.uidLength);
+        }
+        if (cardInfo.sectorPending) {
+          if (!authorized) {
+            break;  // Wait for a cloned UID from the custom sector
+          }
+          _readers.lastReader().skipCustomSector();
+        }
+        TAP_TRACE(TracePoint::DECISION);
+        if (authorized) {
+          grantAccess();
+        } else {
+          denyAccess();
+        }
+        TAP_TRACE_END(authorized);
+        
         // Show physical UID
+        if (_readers.count() > 1) {
+          Serial.print(F("Reader "));
+          Serial.print(_readers.lastReaderIndex());
+          Serial.print(F(": "));
+        }
         Serial.print(F("Physical UID: "));
         for (uint8_t i = 0; i < cardInfo.uidLength; i++) {
           if (cardInfo.uid[i] < 0x10) Serial.print(F("0"));
@@ -161,12 +185,10 @@ void AccessControlSystem::update() {
           Serial.println(F(" (from Sector 1)"));
         }
         
-        if (isCardAuthorized(cardInfo)) {
+        if (authorized) {
           Serial.println(F("Access GRANTED"));
-          grantAccess();
         } else {
           Serial.println(F("Access DENIED"));
-          denyAccess();
         }
       }
       break;
@@ -250,8 +272,7 @@ void AccessControlSystem::update() {
         
         if (sameCard) {
           Serial.println(F("Error: Same card scanned twice"));
-          displayMessage("Error!", "Same card");
-          setState(SystemState::IDLE);
+          showTimedMessage("Error!", "Same card", CLONE_MESSAGE_TIME, SystemState::IDLE);
           break;
         }
         
@@ -259,9 +280,7 @@ void AccessControlSystem::update() {
         if (cardInfo.cardType != NFCCardType::MIFARE_CLASSIC_1K && 
             cardInfo.cardType != NFCCardType::MIFARE_CLASSIC_4K) {
           Serial.println(F("Error: Target must be Mifare Classic 1K/4K"));
-          displayMessage("Error!", "Need Classic 1K");
-          delay(2000);
-          setState(SystemState::IDLE);
+          showTimedMessage("Error!", "Need Classic 1K", CLONE_MESSAGE_TIME, SystemState::IDLE);
           break;
         }
         
@@ -279,34 +298,37 @@ void AccessControlSystem::update() {
         Serial.println();
         
         displayMessage("Cloning to", "Sector 1...");
-        delay(100); // Brief delay for display
+        _display.flush();  // Whole message now: the write below holds up the loop
         
         // Write cloned UID to custom sector (works on ANY Mifare Classic card)
-        bool success = _nfc.writeClonedUID(sourceUID, sourceLength);
+        bool success = _readers.lastReader().writeClonedUID(sourceUID, sourceLength);
         
         if (success) {
           Serial.println(F("SUCCESS: Cloned UID written to custom sector!"));
-          displayMessage("Clone SUCCESS!", "Sector 1 OK");
+          showTimedMessage("Clone SUCCESS!", "Sector 1 OK", CLONE_MESSAGE_TIME, SystemState::IDLE);
         } else {
           Serial.println(F("FAILED: Could not write to custom sector"));
-          displayMessage("Clone Failed!", "Write error");
+          showTimedMessage("Clone Failed!", "Write error", CLONE_MESSAGE_TIME, SystemState::IDLE);
         }
-        
-        delay(2000); // Give time to read the message
-        
-        // Reset NFC reader state after delay to allow new card detection
-        _nfc.resetCardState();
-        Serial.println(F("NFC reader reset, ready for next card"));
-        
-        setState(SystemState::IDLE);
       }
       break;
       
     default:
       break;
   }
+  LOOP_PROFILE_PHASE(LoopPhase::STATE);
+  
+  // Reclaim space from deleted cards while idle, one step per
+  // drained write queue so the loop never waits on the EEPROM
+  if (_currentState == SystemState::IDLE && EEPROMQueue.idle() && _cards.needsCompaction()) {
+    _cards.compactStep();
+  }
+  LOOP_PROFILE_PHASE(LoopPhase::COMPACTION);
   
   updateDisplay();
+  _display.flush(LCD_FLUSH_BUDGET_US);
+  LOOP_PROFILE_PHASE(LoopPhase::DISPLAY);
+  LOOP_PROFILE_END();
 }
 
 void AccessControlSystem::updateButtons() {
@@ -317,6 +339,12 @@ void AccessControlSystem::updateButtons() {
   
   _lastActivityTime = millis();
   
+  // Someone at the panel is likely to tap a card next
+  if (upNow != _btnUpPressed || downNow != _btnDownPressed ||
+      selectNow != _btnSelectPressed || backNow != _btnBackPressed) {
+    _readers.notifyActivity();
+  }
+  
   if (upNow && !_btnUpPressed) {
     Serial.println(F("BTN: UP"));
     if (_currentState == SystemState::LISTING_CARDS) {
@@ -548,82 +576,90 @@ void AccessControlSystem::updateDisplay() {
 }
 
 void AccessControlSystem::displayIdle() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print((__FlashStringHelper*)STR_SYSTEM_READY);
-  _lcd.setCursor(0, 1);
-  _lcd.print((__FlashStringHelper*)STR_SCAN_CARD);
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print((__FlashStringHelper*)STR_SYSTEM_READY);
+  _display.setCursor(0, 1);
+  _display.print((__FlashStringHelper*)STR_SCAN_CARD);
 }
 
 void AccessControlSystem::displayAccessGranted() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print((__FlashStringHelper*)STR_ACCESS_GRANTED);
-  _lcd.setCursor(0, 1);
-  _lcd.print((__FlashStringHelper*)STR_WELCOME);
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print((__FlashStringHelper*)STR_ACCESS_GRANTED);
+  _display.setCursor(0, 1);
+  _display.print((__FlashStringHelper*)STR_WELCOME);
 }
 
 void AccessControlSystem::displayAccessDenied() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print((__FlashStringHelper*)STR_ACCESS_DENIED);
-  _lcd.setCursor(0, 1);
-  _lcd.print((__FlashStringHelper*)STR_UNKNOWN_CARD);
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print((__FlashStringHelper*)STR_ACCESS_DENIED);
+  _display.setCursor(0, 1);
+  _display.print((__FlashStringHelper*)STR_UNKNOWN_CARD);
 }
 
 void AccessControlSystem::displayMenu() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print(F(">"));
-  _lcd.print((__FlashStringHelper*)getMenuItemName(_currentMenuItem));
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print(F(">"));
+  _display.print((__FlashStringHelper*)getMenuItemName(_currentMenuItem));
   
   // Show next item on second line
   MenuItem nextItem = (MenuItem)((_menuIndex + 1) % (uint8_t)MenuItem::MENU_COUNT);
-  _lcd.setCursor(0, 1);
-  _lcd.print(F(" "));
-  _lcd.print((__FlashStringHelper*)getMenuItemName(nextItem));
+  _display.setCursor(0, 1);
+  _display.print(F(" "));
+  _display.print((__FlashStringHelper*)getMenuItemName(nextItem));
 }
 
 void AccessControlSystem::displayRegistering() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print("Register Card");
-  _lcd.setCursor(0, 1);
-  _lcd.print("Scan new card...");
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print("Register Card");
+  _display.setCursor(0, 1);
+  _display.print("Scan new card...");
 }
 
 void AccessControlSystem::displayDeleting() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print("Delete Card");
-  _lcd.setCursor(0, 1);
-  _lcd.print("Scan to delete..");
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print("Delete Card");
+  _display.setCursor(0, 1);
+  _display.print("Scan to delete..");
 }
 
 void AccessControlSystem::displayCloning() {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
+  _display.clear();
+  _display.setCursor(0, 0);
   if (_currentState == SystemState::CLONING_SOURCE) {
-    _lcd.print("Clone: Source");
-    _lcd.setCursor(0, 1);
-    _lcd.print("Scan source card");
+    _display.print("Clone: Source");
+    _display.setCursor(0, 1);
+    _display.print("Scan source card");
   } else {
-    _lcd.print("Clone: Target");
-    _lcd.setCursor(0, 1);
-    _lcd.print("Scan magic card");
+    _display.print("Clone: Target");
+    _display.setCursor(0, 1);
+    _display.print("Scan magic card");
   }
 }
 
 void AccessControlSystem::displayMessage(const char* line1, const char* line2) {
-  _lcd.clear();
-  _lcd.setCursor(0, 0);
-  _lcd.print(line1);
-  _lcd.setCursor(0, 1);
-  _lcd.print(line2);
+  _display.clear();
+  _display.setCursor(0, 0);
+  _display.print(line1);
+  _display.setCursor(0, 1);
+  _display.print(line2);
+}
+
+// Shows a message for duration ms, then moves on from checkStateTimeout()
+void AccessControlSystem::showTimedMessage(const char* line1, const char* line2, unsigned long duration, SystemState nextState) {
+  setState(SystemState::SHOWING_MESSAGE);
+  _messageDuration = duration;
+  _messageNextState = nextState;
+  displayMessage(line1, line2);
 }
 
 void AccessControlSystem::clearDisplay() {
-  _lcd.clear();
+  _display.clear();
 }
 
 // ========== STATE MANAGEMENT ==========
@@ -653,6 +689,13 @@ void AccessControlSystem::checkStateTimeout() {
     setState(SystemState::IDLE);
   }
   
+  // Timed message done; cards scanned meanwhile were ignored, so let
+  // the reader report a card still in the field to the next state
+  if (_currentState == SystemState::SHOWING_MESSAGE && (now - _stateChangeTime >= _messageDuration)) {
+    _readers.resetCardState();
+    setState(_messageNextState);
+  }
+  
   // Menu timeout
   if (_currentState == SystemState::MENU && (now - _lastActivityTime >= MENU_TIMEOUT)) {
     exitMenu();
@@ -662,133 +705,33 @@ void AccessControlSystem::checkStateTimeout() {
 // ========== CARD MANAGEMENT ==========
 
 bool AccessControlSystem::isCardAuthorized(const NFCCardInfo& cardInfo) {
-  return findCardInEEPROM(cardInfo) >= 0;
+  return _cards.contains(cardInfo.getEffectiveUID(), cardInfo.getEffectiveUIDLength());
 }
 
+// Use effective UID (cloned if present, otherwise physical)
 bool AccessControlSystem::addCard(const NFCCardInfo& cardInfo) {
-  // Check if card already exists
-  if (findCardInEEPROM(cardInfo) >= 0) {
-    return false; // Card already registered
-  }
-  
-  uint8_t count = _cardCountCacheValid ? _cachedCardCount : loadCardCount();
-  if (count >= MAX_STORED_CARDS) {
-    return false; // Storage full
-  }
-  
-  // Add new card - use effective UID (cloned if present, otherwise physical)
-  StoredCard card;
-  const uint8_t* effectiveUID = cardInfo.getEffectiveUID();
-  uint8_t effectiveLength = cardInfo.getEffectiveUIDLength();
-  
-  memcpy(card.uid, effectiveUID, effectiveLength);
-  card.uidLength = effectiveLength;
-  card.active = true;
-  
-  saveCardToEEPROM(card, count);
-  saveCardCount(count + 1);
-  
-  return true;
+  return _cards.add(cardInfo.getEffectiveUID(), cardInfo.getEffectiveUIDLength());
 }
 
 bool AccessControlSystem::deleteCard(const NFCCardInfo& cardInfo) {
-  int index = findCardInEEPROM(cardInfo);
-  if (index < 0) {
-    return false; // Card not found
-  }
-  
-  // Shift all cards after this one
-  uint8_t count = _cardCountCacheValid ? _cachedCardCount : loadCardCount();
-  for (int i = index; i < count - 1; i++) {
-    StoredCard card;
-    loadCardFromEEPROM(card, i + 1);
-    saveCardToEEPROM(card, i);
-  }
-  
-  saveCardCount(count - 1);
-  return true;
+  return _cards.remove(cardInfo.getEffectiveUID(), cardInfo.getEffectiveUIDLength());
 }
 
 void AccessControlSystem::clearAllCards() {
-  saveCardCount(0);
+  _cards.clear();
 }
 
 uint8_t AccessControlSystem::getStoredCardCount() {
-  return _cardCountCacheValid ? _cachedCardCount : loadCardCount();
-}
-
-int AccessControlSystem::findCardInEEPROM(const NFCCardInfo& cardInfo) {
-  uint8_t count = _cardCountCacheValid ? _cachedCardCount : loadCardCount();
-  
-  // Use effective UID (cloned if present, otherwise physical)
-  const uint8_t* effectiveUID = cardInfo.getEffectiveUID();
-  uint8_t effectiveLength = cardInfo.getEffectiveUIDLength();
-  
-  for (uint8_t i = 0; i < count; i++) {
-    StoredCard card;
-    if (loadCardFromEEPROM(card, i)) {
-      if (card.active && card.uidLength == effectiveLength) {
-        if (compareUIDs(card.uid, effectiveUID, effectiveLength)) {
-          return i;
-        }
-      }
-    }
-  }
-  
-  return -1;
-}
-
-bool AccessControlSystem::compareUIDs(const uint8_t* uid1, const uint8_t* uid2, uint8_t length) {
-  for (uint8_t i = 0; i < length; i++) {
-    if (uid1[i] != uid2[i]) {
-      return false;
-    }
-  }
-  return true;
-}
-
-// ========== EEPROM OPERATIONS ==========
-
-void AccessControlSystem::saveCardToEEPROM(const StoredCard& card, uint8_t index) {
-  uint16_t addr = EEPROM_CARDS_START + (index * (MAX_UID_LENGTH + 2));
-  
-  EEPROM.write(addr++, card.uidLength);
-  EEPROM.write(addr++, card.active ? 1 : 0);
-  
-  for (uint8_t i = 0; i < MAX_UID_LENGTH; i++) {
-    EEPROM.write(addr++, card.uid[i]);
-  }
-}
-
-bool AccessControlSystem::loadCardFromEEPROM(StoredCard& card, uint8_t index) {
-  uint16_t addr = EEPROM_CARDS_START + (index * (MAX_UID_LENGTH + 2));
-  
-  card.uidLength = EEPROM.read(addr++);
-  card.active = EEPROM.read(addr++) == 1;
-  
-  for (uint8_t i = 0; i < MAX_UID_LENGTH; i++) {
-    card.uid[i] = EEPROM.read(addr++);
-  }
-  
-  return card.uidLength > 0 && card.uidLength <= MAX_UID_LENGTH;
-}
-
-void AccessControlSystem::saveCardCount(uint8_t count) {
-  EEPROM.write(EEPROM_CARD_COUNT_ADDR, count);
-  _cachedCardCount = count;
-  _cardCountCacheValid = true;
-}
-
-uint8_t AccessControlSystem::loadCardCount() {
-  return EEPROM.read(EEPROM_CARD_COUNT_ADDR);
+  return _cards.count();
 }
 
 // ========== ACCESS CONTROL ==========
 
+// Relay first; the screen catches up over the next few loops
 void AccessControlSystem::grantAccess() {
+  unlockDoor();
   setState(SystemState::ACCESS_GRANTED);
   displayAccessGranted();
-  unlockDoor();
 }
 
 void AccessControlSystem::denyAccess() {
@@ -798,6 +741,7 @@ void AccessControlSystem::denyAccess() {
 
 void AccessControlSystem::unlockDoor() {
   digitalWrite(RELAY_PIN, RELAY_ACTIVE_HIGH ? HIGH : LOW);
+  TAP_TRACE(TracePoint::RELAY);
   _relayActive = true;
   _relayActivationTime = millis();
 }
@@ -830,28 +774,28 @@ void AccessControlSystem::displayListingCards() {
   uint8_t count = getStoredCardCount();
   StoredCard card;
   
-  _lcd.clear();
+  _display.clear();
   
-  if (loadCardFromEEPROM(card, _listCardIndex)) {
+  if (_cards.cardAt(_listCardIndex, card)) {
     // Line 1: Card number and indicator
-    _lcd.setCursor(0, 0);
-    _lcd.print("#");
-    _lcd.print(_listCardIndex + 1);
-    _lcd.print("/");
-    _lcd.print(count);
-    _lcd.print(" [Cloned]");
+    _display.setCursor(0, 0);
+    _display.print("#");
+    _display.print(_listCardIndex + 1);
+    _display.print("/");
+    _display.print(count);
+    _display.print(" [Cloned]");
     
     // Line 2: UID from custom sector (truncated to fit)
-    _lcd.setCursor(0, 1);
+    _display.setCursor(0, 1);
     for (uint8_t i = 0; i < min(card.uidLength, (uint8_t)7); i++) {
-      if (card.uid[i] < 0x10) _lcd.print("0");
-      _lcd.print(card.uid[i], HEX);
-      if (i < min(card.uidLength, (uint8_t)7) - 1) _lcd.print(" ");
+      if (card.uid[i] < 0x10) _display.print("0");
+      _display.print(card.uid[i], HEX);
+      if (i < min(card.uidLength, (uint8_t)7) - 1) _display.print(" ");
     }
   } else {
-    _lcd.setCursor(0, 0);
-    _lcd.print("Error reading");
-    _lcd.setCursor(0, 1);
-    _lcd.print("card data");
+    _display.setCursor(0, 0);
+    _display.print("Error reading");
+    _display.setCursor(0, 1);
+    _display.print("card data");
   }
 }
@@ -0,0 +1,473 @@
+#include "CardStore.h"
+
+CardStore::CardStore()
+  : _head(CardLayout::LOG_START),
+    _tail(CardLayout::LOG_START),
+    _garbageBytes(0),
+    _journalSlot(0),
+    _journalSeq(0),
+    _count(0),
+    _indexCount(0),
+    _filterStats()
+{
+  memset(_bloom, 0, sizeof(_bloom));
+}
+
+void CardStore::begin() {
+  uint16_t magic = (EEPROMQueue.read(EEPROM_MAGIC_ADDR) << 8) | EEPROMQueue.read(EEPROM_MAGIC_ADDR + 1);
+  
+  if (magic == EEPROM_LEGACY_MAGIC) {
+    migrateLegacy();
+  } else if (magic == EEPROM_PACKED_MAGIC) {
+    // A packed table is already a valid log starting at LOG_START
+    Serial.print(F("converting card table to log... "));
+    format(CardLayout::LOG_START, packedTableEnd());
+  } else if (magic != EEPROM_MAGIC_NUMBER) {
+    // First time - initialize EEPROM
+    format(CardLayout::LOG_START, CardLayout::LOG_START);
+  } else if (!loadJournal()) {
+    Serial.print(F("journal corrupt, cards cleared... "));
+    format(CardLayout::LOG_START, CardLayout::LOG_START);
+  }
+  
+  // Walk the log once to build the RAM index
+  scanLog();
+}
+
+// ========== LAYOUT SETUP ==========
+
+// Start a journal whose only valid entry covers [head, tail).
+// The magic goes last so an interrupted format is simply redone.
+void CardStore::format(uint16_t head, uint16_t tail) {
+  for (uint8_t i = 1; i < CARD_JOURNAL_ENTRIES; i++) {
+    EEPROMQueue.write(CardLayout::JOURNAL_START + i * CardLayout::JOURNAL_ENTRY_SIZE + 4, 0);
+  }
+  _journalSlot = CARD_JOURNAL_ENTRIES - 1;
+  _journalSeq = 0xFF;
+  commit(head, tail);
+  
+  EEPROMQueue.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_NUMBER >> 8);
+  EEPROMQueue.write(EEPROM_MAGIC_ADDR + 1, EEPROM_MAGIC_NUMBER & 0xFF);
+}
+
+// Repack a table of fixed 9-byte records into the log space past it and
+// start the log there. The old table is only overwritten by later appends,
+// once the new magic is in, so a reset part-way through redoes the migration.
+void CardStore::migrateLegacy() {
+  uint8_t legacyCount = EEPROMQueue.read(EEPROM_CARD_COUNT_ADDR);
+  uint16_t head = CardLayout::LEGACY_END;
+  uint16_t writeAddr = head;
+  
+  Serial.print(F("migrating "));
+  Serial.print(legacyCount);
+  Serial.print(F(" cards... "));
+  
+  for (uint8_t i = 0; i < legacyCount && i < CardLayout::LEGACY_MAX_CARDS; i++) {
+    uint16_t addr = CardLayout::LOG_START + i * CardLayout::LEGACY_RECORD_SIZE;
+    StoredCard card;
+    card.uidLength = EEPROMQueue.read(addr);
+    card.active = EEPROMQueue.read(addr + 1) == 1;
+    for (uint8_t j = 0; j < MAX_UID_LENGTH; j++) {
+      card.uid[j] = EEPROMQueue.read(addr + 2 + j);
+    }
+  
+    // Check the raw length byte: a header only encodes 4 and 7
+    if (!card.active || !CardLayout::isValidLength(card.uidLength)) {
+      continue;
+    }
+    writeRecord(card, writeAddr);
+    writeAddr += CardLayout::recordSize(card.uidLength);
+  }
+  
+  format(head, writeAddr);
+}
+
+uint16_t CardStore::packedTableEnd() {
+  uint8_t count = EEPROMQueue.read(EEPROM_CARD_COUNT_ADDR);
+  uint16_t addr = CardLayout::LOG_START;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t header = EEPROMQueue.read(addr);
+    if (!CardLayout::isValid(header) ||
+        addr + CardLayout::recordSize(CardLayout::uidLength(header)) + CardLayout::COMPACT_RESERVE > CardLayout::LOG_END) {
+      break;
+    }
+    addr += CardLayout::recordSize(CardLayout::uidLength(header));
+  }
+  return addr;
+}
+
+// The current entry is the last one in the run of consecutive sequence numbers
+bool CardStore::loadJournal() {
+  uint8_t slot = 0;
+  uint8_t seq = EEPROMQueue.read(CardLayout::JOURNAL_START + 4);
+  for (uint8_t i = 1; i < CARD_JOURNAL_ENTRIES; i++) {
+    uint8_t next = EEPROMQueue.read(CardLayout::JOURNAL_START + i * CardLayout::JOURNAL_ENTRY_SIZE + 4);
+    if (next != (uint8_t)(seq + 1)) {
+      break;
+    }
+    slot = i;
+    seq = next;
+  }
+  
+  uint16_t addr = CardLayout::JOURNAL_START + slot * CardLayout::JOURNAL_ENTRY_SIZE;
+  uint16_t head = (EEPROMQueue.read(addr) << 8) | EEPROMQueue.read(addr + 1);
+  uint16_t tail = (EEPROMQueue.read(addr + 2) << 8) | EEPROMQueue.read(addr + 3);
+  if (head < CardLayout::LOG_START || head >= CardLayout::LOG_END ||
+      tail < CardLayout::LOG_START || tail >= CardLayout::LOG_END) {
+    return false;
+  }
+  
+  _journalSlot = slot;
+  _journalSeq = seq;
+  _head = head;
+  _tail = tail;
+  return true;
+}
+
+void CardStore::scanLog() {
+  _count = 0;
+  _garbageBytes = 0;
+  _indexCount = 0;
+  memset(_bloom, 0, sizeof(_bloom));
+  
+  uint16_t addr = _head;
+  uint16_t remaining = (_tail + CardLayout::LOG_SIZE - _head) % CardLayout::LOG_SIZE;
+  while (remaining > 0) {
+    StoredCard card;
+    uint8_t header = EEPROMQueue.read(addr);
+    uint16_t size;
+    if (header == CardLayout::WRAP_MARKER) {
+      size = CardLayout::LOG_END - addr;
+    } else {
+      size = CardLayout::recordSize(CardLayout::uidLength(header));
+    }
+  
+    if ((header != CardLayout::WRAP_MARKER && !readRecord(card, addr)) || size > remaining) {
+      // Records past a damaged header can't be located; drop them
+      Serial.print(F("log truncated... "));
+      _tail = addr;
+      break;
+    }
+  
+    if (header == CardLayout::WRAP_MARKER || !card.active) {
+      _garbageBytes += size;
+    } else {
+      indexInsert(fingerprintUID(card.uid, card.uidLength), addr);
+      _count++;
+    }
+    addr = header == CardLayout::WRAP_MARKER ? CardLayout::LOG_START : advance(addr, size);
+    remaining -= size;
+  }
+}
+
+// ========== CARD MANAGEMENT ==========
+
+bool CardStore::contains(const uint8_t* uid, uint8_t length) {
+  return find(uid, length) >= 0;
+}
+
+bool CardStore::add(const uint8_t* uid, uint8_t length) {
+  if (!CardLayout::isValidLength(length) || find(uid, length) >= 0 || _count >= MAX_STORED_CARDS) {
+    return false;
+  }
+  
+  // Make room in the foreground if background compaction hasn't kept up
+  uint8_t size = CardLayout::recordSize(length);
+  while (freeBytes() < size + CardLayout::COMPACT_RESERVE && compactStep()) {
+  }
+  if (freeBytes() < size + CardLayout::COMPACT_RESERVE) {
+    return false;
+  }
+  
+  StoredCard card;
+  memcpy(card.uid, uid, length);
+  card.uidLength = length;
+  card.active = true;
+  
+  uint16_t addr = append(card, _head);
+  _count++;
+  indexInsert(fingerprintUID(uid, length), addr);
+  return true;
+}
+
+// Tombstone the record in place: a single byte write
+bool CardStore::remove(const uint8_t* uid, uint8_t length) {
+  int addr = find(uid, length);
+  if (addr < 0) {
+    return false;
+  }
+  
+  EEPROMQueue.write(addr, CardLayout::header(length, false));
+  _garbageBytes += CardLayout::recordSize(length);
+  _count--;
+  indexRemove(addr);
+  return true;
+}
+
+// Drop the whole live region by moving the head up to the tail
+void CardStore::clear() {
+  commit(_tail, _tail);
+  _count = 0;
+  _garbageBytes = 0;
+  _indexCount = 0;
+  memset(_bloom, 0, sizeof(_bloom));
+}
+
+bool CardStore::cardAt(uint8_t position, StoredCard& card) {
+  uint16_t addr = _head;
+  while (addr != _tail) {
+    uint8_t header = EEPROMQueue.read(addr);
+    if (header == CardLayout::WRAP_MARKER) {
+      addr = CardLayout::LOG_START;
+      continue;
+    }
+    if (!readRecord(card, addr)) {
+      return false;
+    }
+    if (card.active && position-- == 0) {
+      return true;
+    }
+    addr = advance(addr, CardLayout::recordSize(card.uidLength));
+  }
+  return false;
+}
+
+// ========== COMPACTION ==========
+
+bool CardStore::needsCompaction() const {
+  return _garbageBytes > 0 && freeBytes() < CARD_COMPACT_FREE_BYTES;
+}
+
+// Either skip the dead records at the head (journal write only) or move
+// the live record at the head to the tail so the head can pass it
+bool CardStore::compactStep() {
+  if (_garbageBytes == 0) {
+    return false;
+  }
+  
+  uint16_t head = _head;
+  while (head != _tail) {
+    uint8_t header = EEPROMQueue.read(head);
+    if (header == CardLayout::WRAP_MARKER) {
+      _garbageBytes -= CardLayout::LOG_END - head;
+      head = CardLayout::LOG_START;
+    } else if (!CardLayout::isActive(header)) {
+      uint8_t size = CardLayout::recordSize(CardLayout::uidLength(header));
+      _garbageBytes -= size;
+      head = advance(head, size);
+    } else {
+      break;
+    }
+  }
+  if (head != _head) {
+    commit(head, _tail);
+    return true;
+  }
+  
+  StoredCard card;
+  if (head == _tail || !readRecord(card, head)) {
+    return false;
+  }
+  uint8_t size = CardLayout::recordSize(card.uidLength);
+  if (freeBytes() < size + CardLayout::MAX_RECORD_SIZE) {
+    return false;
+  }
+  
+  // The copy and the dropped original become visible in the same journal entry
+  uint16_t addr = append(card, advance(head, size));
+  indexMove(fingerprintUID(card.uid, card.uidLength), head, addr);
+  return true;
+}
+
+// ========== LOG OPERATIONS ==========
+
+uint16_t CardStore::freeBytes() const {
+  uint16_t used = (_tail + CardLayout::LOG_SIZE - _head) % CardLayout::LOG_SIZE;
+  return CardLayout::LOG_SIZE - used - 1;
+}
+
+uint16_t CardStore::advance(uint16_t addr, uint8_t size) const {
+  addr += size;
+  return addr >= CardLayout::LOG_END ? CardLayout::LOG_START : addr;
+}
+
+// Write a journal entry into the next slot, sequence byte last
+void CardStore::commit(uint16_t head, uint16_t tail) {
+  _journalSlot = (_journalSlot + 1) % CARD_JOURNAL_ENTRIES;
+  _journalSeq++;
+  
+  uint16_t addr = CardLayout::JOURNAL_START + _journalSlot * CardLayout::JOURNAL_ENTRY_SIZE;
+  EEPROMQueue.write(addr, head >> 8);
+  EEPROMQueue.write(addr + 1, head & 0xFF);
+  EEPROMQueue.write(addr + 2, tail >> 8);
+  EEPROMQueue.write(addr + 3, tail & 0xFF);
+  EEPROMQueue.write(addr + 4, _journalSeq);
+  
+  _head = head;
+  _tail = tail;
+}
+
+// Write a record at the tail, wrapping to LOG_START if it doesn't fit
+// before the journal, and commit it together with the given head.
+// Callers check freeBytes() first.
+uint16_t CardStore::append(const StoredCard& card, uint16_t head) {
+  uint8_t size = CardLayout::recordSize(card.uidLength);
+  uint16_t addr = _tail;
+  
+  if (addr + size > CardLayout::LOG_END) {
+    EEPROMQueue.write(addr, CardLayout::WRAP_MARKER);
+    _garbageBytes += CardLayout::LOG_END - addr;
+    addr = CardLayout::LOG_START;
+  }
+  
+  writeRecord(card, addr);
+  commit(head, advance(addr, size));
+  return addr;
+}
+
+int CardStore::find(const uint8_t* uid, uint8_t length) {
+  // Unknown cards are normally rejected by the Bloom filter alone. Otherwise
+  // binary search the RAM index, then confirm the candidate in EEPROM.
+  // Distinct UIDs rarely share a fingerprint, so this is normally one record read.
+  uint32_t fingerprint = fingerprintUID(uid, length);
+  _filterStats.lookups++;
+  if (!bloomMayContain(fingerprint)) {
+    _filterStats.rejects++;
+    return -1;
+  }
+  
+  for (uint8_t pos = findIndexPosition(fingerprint);
+       pos < _indexCount && _index[pos].fingerprint == fingerprint; pos++) {
+    StoredCard card;
+    if (readRecord(card, _index[pos].addr)) {
+      if (card.active && card.uidLength == length) {
+        if (memcmp(card.uid, uid, length) == 0) {
+          return _index[pos].addr;
+        }
+      }
+    }
+  }
+  
+  _filterStats.falsePositives++;
+  return -1;
+}
+
+void CardStore::writeRecord(const StoredCard& card, uint16_t addr) {
+  EEPROMQueue.write(addr++, CardLayout::header(card.uidLength, card.active));
+  
+  for (uint8_t i = 0; i < card.uidLength; i++) {
+    EEPROMQueue.write(addr++, card.uid[i]);
+  }
+}
+
+bool CardStore::readRecord(StoredCard& card, uint16_t addr) {
+  uint8_t header = EEPROMQueue.read(addr++);
+  if (!CardLayout::isValid(header) ||
+      addr + CardLayout::uidLength(header) > CardLayout::LOG_END) {
+    return false;
+  }
+  
+  card.uidLength = CardLayout::uidLength(header);
+  card.active = CardLayout::isActive(header);
+  
+  for (uint8_t i = 0; i < card.uidLength; i++) {
+    card.uid[i] = EEPROMQueue.read(addr++);
+  }
+  
+  return true;
+}
+
+// ========== CARD INDEX ==========
+
+// FNV-1a over length + UID bytes, top FINGERPRINT_BITS kept
+uint32_t CardStore::fingerprintUID(const uint8_t* uid, uint8_t length) {
+  uint32_t hash = 2166136261UL;
+  hash = (hash ^ length) * 16777619UL;
+  for (uint8_t i = 0; i < length; i++) {
+    hash = (hash ^ uid[i]) * 16777619UL;
+  }
+  return hash >> CardLayout::ADDR_BITS;
+}
+
+// First position whose fingerprint is >= the given one
+uint8_t CardStore::findIndexPosition(uint32_t fingerprint) {
+  uint8_t low = 0;
+  uint8_t high = _indexCount;
+  while (low < high) {
+    uint8_t mid = (low + high) / 2;
+    if (_index[mid].fingerprint < fingerprint) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void CardStore::indexInsert(uint32_t fingerprint, uint16_t addr) {
+  if (_indexCount >= MAX_STORED_CARDS) {
+    return;
+  }
+  
+  uint8_t pos = findIndexPosition(fingerprint);
+  memmove(&_index[pos + 1], &_index[pos], (_indexCount - pos) * sizeof(CardIndexEntry));
+  _index[pos].fingerprint = fingerprint;
+  _index[pos].addr = addr;
+  _indexCount++;
+  bloomAdd(fingerprint);
+}
+
+void CardStore::indexRemove(uint16_t addr) {
+  for (uint8_t i = 0; i < _indexCount; i++) {
+    if (_index[i].addr == addr) {
+      memmove(&_index[i], &_index[i + 1], (_indexCount - i - 1) * sizeof(CardIndexEntry));
+      _indexCount--;
+      break;
+    }
+  }
+  
+  // Bits can't be cleared per card, so refill the filter from what's left
+  rebuildBloom();
+}
+
+// Follow a record relocated by compaction; the fingerprint, and so the
+// entry's position, doesn't change
+void CardStore::indexMove(uint32_t fingerprint, uint16_t from, uint16_t to) {
+  for (uint8_t pos = findIndexPosition(fingerprint);
+       pos < _indexCount && _index[pos].fingerprint == fingerprint; pos++) {
+    if (_index[pos].addr == from) {
+      _index[pos].addr = to;
+      return;
+    }
+  }
+}
+
+// ========== BLOOM FILTER ==========
+
+// Double hashing: bit i = h1 + i*h2, both halves of the UID fingerprint
+#define BLOOM_HALF (CardLayout::FINGERPRINT_BITS / 2)
+#define BLOOM_BIT(fp, i) ((uint16_t)(((fp) & ((1UL << BLOOM_HALF) - 1)) + (i) * (((fp) >> BLOOM_HALF) | 1)) & (CARD_BLOOM_BITS - 1))
+
+void CardStore::bloomAdd(uint32_t fingerprint) {
+  for (uint8_t i = 0; i < CARD_BLOOM_HASHES; i++) {
+    uint16_t bit = BLOOM_BIT(fingerprint, i);
+    _bloom[bit >> 3] |= (1 << (bit & 7));
+  }
+}
+
+bool CardStore::bloomMayContain(uint32_t fingerprint) {
+  for (uint8_t i = 0; i < CARD_BLOOM_HASHES; i++) {
+    uint16_t bit = BLOOM_BIT(fingerprint, i);
+    if (!(_bloom[bit >> 3] & (1 << (bit & 7)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CardStore::rebuildBloom() {
+  memset(_bloom, 0, sizeof(_bloom));
+  for (uint8_t i = 0; i < _indexCount; i++) {
+    bloomAdd(_index[i].fingerprint);
+  }
+}
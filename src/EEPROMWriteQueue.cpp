@@ -0,0 +1,141 @@
+#include "EEPROMWriteQueue.h"
+
+// Suppress unused variable warning from EEPROM library
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#include <EEPROM.h>
+#pragma GCC diagnostic pop
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+
+ISR(EE_READY_vect) {
+  EEPROMQueue.handleReady();
+}
+
+static inline void enableReadyInterrupt() { EECR |= _BV(EERIE); }
+static inline void disableReadyInterrupt() { EECR &= ~_BV(EERIE); }
+
+// Only called from the ISR, so EEMPE -> EEPE can't be interrupted
+static inline void startWrite(uint16_t addr, uint8_t value) {
+  EEAR = addr;
+  EEDR = value;
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+}
+#else
+#include <NativeHAL.h>
+
+static void readyISR() {
+  EEPROMQueue.handleReady();
+}
+
+static inline void enableReadyInterrupt() { NativeHAL::eepromReadyInterrupt(readyISR); }
+static inline void disableReadyInterrupt() { NativeHAL::eepromReadyInterrupt(nullptr); }
+
+static inline void startWrite(uint16_t addr, uint8_t value) {
+  EEPROM.write(addr, value);
+}
+#endif
+
+EEPROMWriteQueue EEPROMQueue;
+
+EEPROMWriteQueue::EEPROMWriteQueue()
+  : _first(0),
+    _count(0),
+    _inFlight(false),
+    _completed(0),
+    _queued(0),
+    _totalQueued(0),
+    _totalSkipped(0)
+{
+}
+
+void EEPROMWriteQueue::write(uint16_t addr, uint8_t value) {
+  if (read(addr) == value) {
+    _totalSkipped++;
+    return;
+  }
+
+  // The ISR drains the queue while we wait (delay also lets the host build's clock run)
+  while (_count >= EEPROM_WRITE_QUEUE_SIZE) {
+    delayMicroseconds(100);
+  }
+
+  suspend();
+  uint8_t slot = (_first + _count) % EEPROM_WRITE_QUEUE_SIZE;
+  _entries[slot].addr = addr;
+  _entries[slot].value = value;
+  _count++;
+  _queued++;
+  _totalQueued++;
+  resume();
+}
+
+uint8_t EEPROMWriteQueue::read(uint16_t addr) {
+  suspend();
+  bool found;
+  uint8_t value = readPending(addr, found);
+  if (!found) {
+    // Waits for any write in progress, with the ISR held off so it
+    // can't change EEAR underneath us
+    value = EEPROM.read(addr);
+  }
+  resume();
+  return value;
+}
+
+bool EEPROMWriteQueue::isComplete(uint16_t ticket) {
+  suspend();
+  uint16_t completed = _completed;
+  resume();
+  return (int16_t)(completed - ticket) >= 0;
+}
+
+void EEPROMWriteQueue::flush() {
+  while (_count > 0) {
+    delayMicroseconds(100);
+  }
+}
+
+// Fires whenever the EEPROM is idle: retire the write that just finished,
+// then start the next one or switch the interrupt off
+void EEPROMWriteQueue::handleReady() {
+  if (_inFlight) {
+    _inFlight = false;
+    _first = (_first + 1) % EEPROM_WRITE_QUEUE_SIZE;
+    _count--;
+    _completed++;
+  }
+
+  if (_count == 0) {
+    disableReadyInterrupt();
+    return;
+  }
+
+  startWrite(_entries[_first].addr, _entries[_first].value);
+  _inFlight = true;
+}
+
+void EEPROMWriteQueue::suspend() {
+  disableReadyInterrupt();
+}
+
+void EEPROMWriteQueue::resume() {
+  if (_count > 0) {
+    enableReadyInterrupt();
+  }
+}
+
+// Newest queued value for addr, if any
+uint8_t EEPROMWriteQueue::readPending(uint16_t addr, bool& found) {
+  for (uint8_t i = _count; i > 0; i--) {
+    uint8_t slot = (_first + i - 1) % EEPROM_WRITE_QUEUE_SIZE;
+    if (_entries[slot].addr == addr) {
+      found = true;
+      return _entries[slot].value;
+    }
+  }
+  found = false;
+  return 0xFF;
+}
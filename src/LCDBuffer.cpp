@@ -0,0 +1,105 @@
+#include "LCDBuffer.h"
+
+LCDBuffer::LCDBuffer(LiquidCrystal& lcd)
+  : _lcd(lcd),
+    _col(0),
+    _row(0),
+    _lcdCol(0),
+    _lcdRow(0),
+    _dirty(false),
+    _bytesPushed(0),
+    _windowStartBytes(0),
+    _bytesPerSecond(0),
+    _windowStart(0)
+{
+}
+
+void LCDBuffer::begin() {
+  // Start from a known blank screen
+  _lcd.clear();
+  memset(_shadow, ' ', sizeof(_shadow));
+  memset(_glass, ' ', sizeof(_glass));
+  _col = 0;
+  _row = 0;
+  _lcdCol = 0;
+  _lcdRow = 0;
+  _dirty = false;
+  _windowStart = millis();
+}
+
+// ========== DRAWING ==========
+
+void LCDBuffer::clear() {
+  memset(_shadow, ' ', sizeof(_shadow));
+  _col = 0;
+  _row = 0;
+  _dirty = true;
+}
+
+void LCDBuffer::setCursor(uint8_t col, uint8_t row) {
+  _col = col;
+  _row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+size_t LCDBuffer::write(uint8_t value) {
+  if (_col >= LCD_COLS) {
+    return 1;  // Off screen, like the hidden DDRAM columns
+  }
+  _shadow[_row][_col++] = (char)value;
+  _dirty = true;
+  return 1;
+}
+
+// ========== FLUSH ==========
+
+// The buffer itself is the queue: cells still differing from the glass
+// are pending, so a cell redrawn before it was sent goes out only once.
+// Each send takes ~270 us, and the budget is checked before each one.
+void LCDBuffer::flush(uint16_t budgetMicros) {
+  updateRate();
+  if (!_dirty) {
+    return;
+  }
+  
+  unsigned long start = micros();
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    for (uint8_t col = 0; col < LCD_COLS; col++) {
+      char c = _shadow[row][col];
+      if (c == _glass[row][col]) {
+        continue;
+      }
+      if (budgetMicros != 0 && micros() - start >= budgetMicros) {
+        return;  // Out of time, the rest goes next call
+      }
+      
+      // The HD44780 advances its cursor after each character, so only
+      // the first cell of a run of changes needs a setCursor()
+      if (col != _lcdCol || row != _lcdRow) {
+        _lcd.setCursor(col, row);
+        _bytesPushed++;
+        _lcdCol = col;
+        _lcdRow = row;
+        if (budgetMicros != 0 && micros() - start >= budgetMicros) {
+          return;
+        }
+      }
+      _lcd.write((uint8_t)c);
+      _glass[row][col] = c;
+      _lcdCol++;
+      _bytesPushed++;
+    }
+  }
+  _dirty = false;
+}
+
+void LCDBuffer::updateRate() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - _windowStart;
+  if (elapsed < 1000) {
+    return;
+  }
+  
+  _bytesPerSecond = (uint16_t)((_bytesPushed - _windowStartBytes) * 1000 / elapsed);
+  _windowStartBytes = _bytesPushed;
+  _windowStart = now;
+}
@@ -0,0 +1,85 @@
+#include "LoopProfiler.h"
+
+#ifdef LOOP_PROFILING
+
+LoopProfiler LoopProfile;
+
+static const char PHASE_BUTTONS[] PROGMEM = "buttons";
+static const char PHASE_RELAY[] PROGMEM = "relay";
+static const char PHASE_TIMEOUTS[] PROGMEM = "timeouts";
+static const char PHASE_NFC[] PROGMEM = "nfc";
+static const char PHASE_STATE[] PROGMEM = "state";
+static const char PHASE_COMPACTION[] PROGMEM = "compaction";
+static const char PHASE_DISPLAY[] PROGMEM = "display";
+static const char PHASE_TOTAL[] PROGMEM = "total";
+
+static const char* const PHASE_NAMES[] = {
+  PHASE_BUTTONS, PHASE_RELAY, PHASE_TIMEOUTS, PHASE_NFC,
+  PHASE_STATE, PHASE_COMPACTION, PHASE_DISPLAY, PHASE_TOTAL
+};
+
+LoopProfiler::LoopProfiler() {
+  reset();
+}
+
+unsigned long LoopProfiler::record(LoopPhase phase, unsigned long since) {
+  unsigned long now = micros();
+  uint32_t elapsed = now - since;
+  PhaseStats& stats = _phases[(uint8_t)phase];
+  
+  if (elapsed < stats.minMicros) stats.minMicros = elapsed;
+  if (elapsed > stats.maxMicros) stats.maxMicros = elapsed;
+  stats.totalMicros += elapsed;
+  stats.count++;
+  
+  uint8_t bin = 0;
+  while (elapsed > 1 && bin < HISTOGRAM_BINS - 1) {
+    elapsed >>= 1;
+    bin++;
+  }
+  // Saturate so the rare slow bins are never scaled away
+  if (stats.histogram[bin] != 0xFFFF) {
+    stats.histogram[bin]++;
+  }
+  return now;
+}
+
+void LoopProfiler::reset() {
+  memset(_phases, 0, sizeof(_phases));
+  for (uint8_t i = 0; i < (uint8_t)LoopPhase::COUNT; i++) {
+    _phases[i].minMicros = 0xFFFFFFFF;
+  }
+}
+
+// One line per phase: name, count, min/mean/max in us, then the
+// non-empty histogram bins as <lower bound>:<count>
+void LoopProfiler::print() {
+  Serial.println(F("Loop timing (us): phase n min mean max | histogram"));
+  for (uint8_t i = 0; i < (uint8_t)LoopPhase::COUNT; i++) {
+    const PhaseStats& stats = _phases[i];
+    Serial.print((__FlashStringHelper*)PHASE_NAMES[i]);
+    Serial.print(F(" "));
+    Serial.print(stats.count);
+    if (stats.count == 0) {
+      Serial.println();
+      continue;
+    }
+    Serial.print(F(" "));
+    Serial.print(stats.minMicros);
+    Serial.print(F(" "));
+    Serial.print((uint32_t)(stats.totalMicros / stats.count));
+    Serial.print(F(" "));
+    Serial.print(stats.maxMicros);
+    Serial.print(F(" |"));
+    for (uint8_t bin = 0; bin < HISTOGRAM_BINS; bin++) {
+      if (stats.histogram[bin] == 0) continue;
+      Serial.print(F(" "));
+      Serial.print(bin == 0 ? 0UL : 1UL << bin);
+      Serial.print(F(":"));
+      Serial.print(stats.histogram[bin]);
+    }
+    Serial.println();
+  }
+}
+
+#endif // LOOP_PROFILING
@@ -1,20 +1,40 @@
 #include "NFCReader.h"
-#include <Wire.h>
-#include <SPI.h>
 
-// Static instance pointer for IRQ callback
-static NFCReader* _irqInstance = nullptr;
+#ifdef NFC_HSU_SERIAL
+static_assert(&NFC_HSU_SERIAL != &Serial, "NFC_HSU_SERIAL can't be Serial: the console log goes there");
+#endif
 
-// Static IRQ handler
-static void staticIRQHandler() {
-  if (_irqInstance) {
-    _irqInstance->handleIRQ();
+// attachInterrupt() takes a plain function, so each reader in IRQ mode
+// claims a slot whose trampoline forwards to it
+static NFCReader* _irqReaders[NFC_MAX_READERS];
+
+template <uint8_t SLOT>
+static void irqTrampoline() {
+  if (_irqReaders[SLOT]) {
+    _irqReaders[SLOT]->handleIRQ();
   }
 }
 
+#if NFC_MAX_READERS > 4
+#error "NFC_MAX_READERS: add IRQ trampolines for the extra readers"
+#endif
+static void (* const _irqTrampolines[NFC_MAX_READERS])() = {
+  irqTrampoline<0>,
+#if NFC_MAX_READERS > 1
+  irqTrampoline<1>,
+#endif
+#if NFC_MAX_READERS > 2
+  irqTrampoline<2>,
+#endif
+#if NFC_MAX_READERS > 3
+  irqTrampoline<3>,
+#endif
+};
+
 NFCReader::NFCReader(NFCCommMode commMode, NFCReadMode readMode)
   : _commMode(commMode),
     _readMode(readMode),
+    _transport(nullptr),
     _nfc(nullptr),
     _irqPin(2),
     _resetPin(3),
@@ -22,13 +42,47 @@ NFCReader::NFCReader(NFCCommMode commMode, NFCReadMode readMode)
     _spiMISO(12),
     _spiMOSI(11),
     _spiSS(10),
+    _spiClock(0),
+    _i2cClock(100000),
+#ifdef NFC_HSU_SERIAL
+    _hsuSerial(&NFC_HSU_SERIAL),
+#else
+    _hsuSerial(nullptr),
+#endif
+    _hsuBaud(PN532_HSU_DEFAULT_BAUD),
+    _hsuWakeupLength(PN532_HSU_WAKEUP_LENGTH),
+    _irqReady(false),
+    _irqSlot(-1),
     _cardPresent(false),
     _lastIRQTime(0),
+    _lastIRQMicros(0),
     _lastPollTime(0),
+    _detectionStartMicros(0),
+    _lastActivityTime(0),
+    _pollInterval(NFC_POLL_FAST_INTERVAL),
+    _pollWindowStart(0),
+    _pollBusyMicros(0),
+    _pollDutyCycle(0),
+    _pollWindowMicros(0),
+    _passiveRetries(NFC_PASSIVE_RETRIES),
+    _fieldDutyCycling(false),
+    _autoPollPeriod(0),
+    _autoPolling(false),
+    _autoPollStart(0),
+    _fieldOn(false),
+    _fieldOnSince(0),
+    _fieldOnMillis(0),
+    _fieldStatsStart(0),
+    _detectionMicros(0),
+    _detections(0),
     _lastCardDetectedTime(0),
-    _lastCardPresent(false)
+    _lastCardPresent(false),
+    _readPhase(ReadPhase::IDLE),
+    _sectorUnreported(false),
+    _sectorCacheHits(0),
+    _sectorCacheMisses(0)
 {
-  _irqInstance = this;
+  clearSectorCache();
   // Initialize last card info
   _lastCardInfo.detected = false;
   _lastCardInfo.hasClonedUID = false;
@@ -39,7 +93,13 @@ NFCReader::~NFCReader() {
   if (_nfc) {
     delete _nfc;
   }
-  _irqInstance = nullptr;
+  if (_transport) {
+    delete _transport;
+  }
+  if (_irqSlot >= 0) {
+    detachInterrupt(digitalPinToInterrupt(_irqPin));
+    _irqReaders[_irqSlot] = nullptr;
+  }
 }
 
 void NFCReader::setSPIPins(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss) {
@@ -49,15 +109,38 @@ void NFCReader::setSPIPins(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss)
   _spiSS = ss;
 }
 
+void NFCReader::releaseChipSelect() {
+  if (_commMode == NFCCommMode::SPI) {
+    pinMode(_spiSS, OUTPUT);
+    digitalWrite(_spiSS, HIGH);
+  }
+}
+
 bool NFCReader::begin() {
+  if (_commMode == NFCCommMode::HSU && (!_hsuSerial || _hsuSerial == &Serial)) {
+    Serial.println(F("NFC: HSU needs a UART other than Serial"));
+    return false;
+  }
+  if (_readMode == NFCReadMode::IRQ && !claimIRQSlot()) {
+    Serial.println(F("NFC: no free IRQ slot or pin in use"));
+    return false;
+  }
+  
   // Create PN532 instance based on communication mode
   if (_commMode == NFCCommMode::I2C) {
-    _nfc = new Adafruit_PN532(_irqPin, _resetPin);
+    _transport = new PN532I2C(_resetPin, _i2cClock);
     Serial.print(F("PN532 I2C mode"));
+  } else if (_commMode == NFCCommMode::HSU) {
+    _transport = new PN532HSU(*_hsuSerial, _hsuBaud, _hsuWakeupLength);
+    Serial.print(F("PN532 HSU mode"));
+  } else if (_spiClock) {
+    _transport = new PN532HardSPI(_spiSS, _spiClock);
+    Serial.print(F("PN532 HW SPI mode"));
   } else {
-    _nfc = new Adafruit_PN532(_spiSCK, _spiMISO, _spiMOSI, _spiSS);
+    _transport = new PN532SoftSPI(_spiSCK, _spiMISO, _spiMOSI, _spiSS);
     Serial.print(F("PN532 SPI mode"));
   }
+  _nfc = new PN532(*_transport);
   
   if (_readMode == NFCReadMode::IRQ) {
     Serial.println(F(" + IRQ"));
@@ -84,14 +167,26 @@ bool NFCReader::begin() {
   
   // Configure SAM (Security Access Module)
   _nfc->SAMConfig();
+  if (_readMode == NFCReadMode::POLLING && _passiveRetries != PN532_RETRY_FOREVER) {
+    _nfc->setPassiveActivationRetries(_passiveRetries);
+  }
+  resetFieldStats();
   
-  // Setup IRQ mode if enabled
+  // Setup IRQ mode if enabled. The PN532 holds IRQ low while a frame
+  // is waiting, so poll() can check the pin instead of the bus.
   if (_readMode == NFCReadMode::IRQ) {
     pinMode(_irqPin, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(_irqPin), staticIRQHandler, FALLING);
-    _nfc->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    attachInterrupt(digitalPinToInterrupt(_irqPin), _irqTrampolines[_irqSlot], FALLING);
+    if (_commMode != NFCCommMode::HSU) {
+      _nfc->setIrqPin(_irqPin);
+    }
+    startDetection();
     Serial.println(F("Ready (IRQ)"));
   } else {
+    if (_irqReady && _commMode != NFCCommMode::HSU) {
+      pinMode(_irqPin, INPUT_PULLUP);
+      _nfc->setIrqPin(_irqPin);
+    }
     Serial.println(F("Ready (Poll)"));
   }
   
@@ -100,12 +195,37 @@ bool NFCReader::begin() {
 
 uint32_t NFCReader::getFirmwareVersion() {
   if (_nfc) {
+    cancelRead();
     return _nfc->getFirmwareVersion();
   }
   return 0;
 }
 
+// A free trampoline slot, and no other reader on the same interrupt
+bool NFCReader::claimIRQSlot() {
+  if (_irqSlot >= 0) {
+    return true;
+  }
+  int8_t freeSlot = -1;
+  for (uint8_t slot = 0; slot < NFC_MAX_READERS; slot++) {
+    if (!_irqReaders[slot]) {
+      if (freeSlot < 0) {
+        freeSlot = slot;
+      }
+    } else if (digitalPinToInterrupt(_irqReaders[slot]->_irqPin) == digitalPinToInterrupt(_irqPin)) {
+      return false;
+    }
+  }
+  if (freeSlot < 0) {
+    return false;
+  }
+  _irqSlot = freeSlot;
+  _irqReaders[_irqSlot] = this;
+  return true;
+}
+
 void NFCReader::handleIRQ() {
+  _lastIRQMicros = micros();
   unsigned long now = millis();
   // Debounce: ignore interrupts within 500ms of last one
   if (now - _lastIRQTime > 500) {
@@ -127,7 +247,8 @@ void NFCReader::resetCardState() {
   _lastCardDetectedTime = 0;
   // Restart detection in IRQ mode
   if (_readMode == NFCReadMode::IRQ && _nfc) {
-    _nfc->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    cancelRead();
+    startDetection();
   }
 }
 
@@ -139,13 +260,23 @@ bool NFCReader::wasCardRemoved() {
   return (now - _lastCardDetectedTime > CARD_TIMEOUT);
 }
 
-NFCCardType NFCReader::determineCardType(uint8_t uidLength) {
-  if (uidLength == 4) {
-    // Could be Classic 1K or 4K - default to 1K
-    return NFCCardType::MIFARE_CLASSIC_1K;
-  } else if (uidLength == 7) {
-    // Could be Ultralight or NTAG
-    return NFCCardType::MIFARE_ULTRALIGHT;
+// SAK values from NXP AN10833. SAK 0x00 covers both Ultralight and NTAG,
+// which GET_VERSION tells apart afterwards.
+NFCCardType NFCReader::determineCardType(uint8_t sak) {
+  switch (sak) {
+    case 0x00:
+      return NFCCardType::MIFARE_ULTRALIGHT;
+    case 0x08:  // Classic 1K
+    case 0x09:  // Mini, same sector layout for sectors 0-4
+    case 0x28:  // SmartMX with Classic 1K emulation
+    case 0x88:  // Infineon Classic 1K
+      return NFCCardType::MIFARE_CLASSIC_1K;
+    case 0x18:  // Classic 4K
+    case 0x38:  // SmartMX with Classic 4K emulation
+      return NFCCardType::MIFARE_CLASSIC_4K;
+  }
+  if (sak & 0x20) {
+    return NFCCardType::ISO14443_4;
   }
   return NFCCardType::UNKNOWN;
 }
@@ -172,128 +303,47 @@ void NFCReader::printCardInfo(const NFCCardInfo& info) {
   (void)info;  // Suppress unused parameter warning
 }
 
-NFCCardInfo NFCReader::readCard() {
+NFCCardInfo NFCReader::readCard(bool reportUIDFirst) {
   NFCCardInfo info;
   info.detected = false;
   info.uidLength = 0;
   info.cardType = NFCCardType::UNKNOWN;
   info.cardID = 0;
+  info.atqa = 0;
+  info.sak = 0;
+  info.storageSize = 0;
+  info.sectorPending = false;
   
-  uint8_t success;
-  uint8_t uid[7] = {0};
-  uint8_t uidLength;
+  if (!_nfc) {
+    return info;
+  }
   
-  if (_readMode == NFCReadMode::IRQ) {
-    // IRQ mode - check if card was detected by interrupt
-    if (!_cardPresent) {
-      // Check if previous card timed out (removed)
-      unsigned long now = millis();
-      if (_lastCardPresent && (now - _lastCardDetectedTime > CARD_TIMEOUT)) {
-        _lastCardPresent = false;
-        // Card removed - restart detection
-        _nfc->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
-        Serial.println(F("NFC: Card removed, restarting detection"));
-      }
-      return info;
-    }
-    
-    // Only process if enough time passed since last read (debounce)
-    unsigned long now = millis();
-    if (_lastCardPresent && (now - _lastCardDetectedTime < 1000)) {
-      // Same card still present, don't read again
-      _cardPresent = false; // Clear IRQ flag
-      return info;
-    }
-    
-    // Try to read the card
-    success = _nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 100);
-    
-    if (success) {
-      // Copy UID
-      memcpy(info.uid, uid, uidLength);
-      info.uidLength = uidLength;
-      info.detected = true;
-      info.cardType = determineCardType(uidLength);
-      info.cardID = calculateCardID(uid, uidLength);
-      
-      // Initialize cloned UID fields
-      info.hasClonedUID = false;
-      info.clonedUIDLength = 0;
-      memset(info.clonedUID, 0, 7);
+  switch (_readPhase) {
+    case ReadPhase::IDLE:
+      startDetection();
+      break;
       
-      // Store for potential write operations
-      _lastCardInfo = info;
-      _lastCardDetectedTime = millis();
-      _lastCardPresent = true;
+    case ReadPhase::DETECTING:
+      pollDetection(info, reportUIDFirst);
+      break;
       
-      // Try to read custom sector data (for cloned UIDs)
-      // Only for Mifare Classic cards
-      if (info.cardType == NFCCardType::MIFARE_CLASSIC_1K || 
-          info.cardType == NFCCardType::MIFARE_CLASSIC_4K) {
-        readCustomSector(info);
-        _lastCardInfo = info; // Update with cloned UID info
-      }
+    case ReadPhase::UID_REPORTED:
+      startCustomSector();
+      break;
       
-      printCardInfo(info);
-    }
-    
-    // Clear the IRQ flag
-    _cardPresent = false;
-    
-    // In IRQ mode, after reading (especially with authentication), we need to 
-    // restart passive target detection when the card is removed
-    // The timeout mechanism in the beginning of this function handles the restart
-    
-  } else {
-    // Polling mode - actively check for card (throttled)
-    unsigned long now = millis();
-    if (now - _lastPollTime < POLL_INTERVAL) {
-      return info; // Too soon, skip this poll
-    }
-    _lastPollTime = now;
-    
-    success = _nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 50);
-    
-    if (success) {
-      // Check if this is the same card (debounce)
-      if (_lastCardPresent && (now - _lastCardDetectedTime < 1000)) {
-        // Same card still present, don't report again
-        return info;
-      }
-      
-      // Copy UID
-      memcpy(info.uid, uid, uidLength);
-      info.uidLength = uidLength;
-      info.detected = true;
-      info.cardType = determineCardType(uidLength);
-      info.cardID = calculateCardID(uid, uidLength);
-      
-      // Initialize cloned UID fields
-      info.hasClonedUID = false;
-      info.clonedUIDLength = 0;
-      memset(info.clonedUID, 0, 7);
-      
-      // Store for potential write operations
-      _lastCardInfo = info;
-      _lastCardDetectedTime = millis();
-      _lastCardPresent = true;
-      
-      // Try to read custom sector data (for cloned UIDs)
-      // Only for Mifare Classic cards
-      if (info.cardType == NFCCardType::MIFARE_CLASSIC_1K || 
-          info.cardType == NFCCardType::MIFARE_CLASSIC_4K) {
-        readCustomSector(info);
-        _lastCardInfo = info; // Update with cloned UID info
-      }
-      
-      printCardInfo(info);
-    } else {
-      // No card detected - check if card was removed
-      if (_lastCardPresent && (now - _lastCardDetectedTime > CARD_TIMEOUT)) {
-        _lastCardPresent = false;
-        Serial.println(F("NFC: Card removed"));
-      }
-    }
+    case ReadPhase::AUTHENTICATING:
+    case ReadPhase::READING:
+      pollCustomSector(info);
+      break;
+  
+    case ReadPhase::IDENTIFYING:
+    case ReadPhase::RESELECTING:
+      pollIdentification(info);
+      break;
+  
+    case ReadPhase::FIELD_OFF:
+      pollFieldOff();
+      break;
   }
   
   return info;
@@ -305,10 +355,409 @@ bool NFCReader::isCardPresent() {
   } else {
     // In polling mode, we'd need to actually check
     // This is a simplified version
+    cancelRead();
     uint8_t uid[7];
     uint8_t uidLength;
-    return _nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 50);
+    _nfc->startListPassiveTarget(NFC_POLL_TIMEOUT);
+    setFieldOn(true);
+    while (_nfc->poll() == PN532Status::BUSY) {
+      delay(1);
+    }
+    return _nfc->readPassiveTarget(uid, &uidLength);
+  }
+}
+
+// ========== SPLIT-PHASE READ ==========
+
+// Issue InListPassiveTarget, or InAutoPoll with an autopoll period. In
+// IRQ mode the command stays armed until a card arrives; it is re-armed
+// once the last card has timed out.
+void NFCReader::startDetection() {
+  unsigned long now = millis();
+  
+  if (_readMode == NFCReadMode::IRQ) {
+    if (_lastCardPresent) {
+      if (now - _lastCardDetectedTime <= CARD_TIMEOUT) {
+        return;
+      }
+      _lastCardPresent = false;
+      Serial.println(F("NFC: Card removed, restarting detection"));
+    }
+    if (_autoPollPeriod) {
+      _nfc->startAutoPoll(PN532_RETRY_FOREVER, _autoPollPeriod);
+      _autoPolling = true;
+      _autoPollStart = now;
+      setFieldOn(false);
+    } else {
+      _nfc->startListPassiveTarget(0);
+      setFieldOn(true);
+    }
+  } else {
+    schedulePoll(now);
+    if (now - _lastPollTime < _pollInterval) {
+      return; // Too soon, skip this poll
+    }
+    _lastPollTime = now;
+    _nfc->startListPassiveTarget(min((uint16_t)NFC_POLL_TIMEOUT, _pollInterval));
+    setFieldOn(true);
+  }
+  _detectionStartMicros = micros();
+  
+  _readPhase = ReadPhase::DETECTING;
+}
+
+void NFCReader::pollDetection(NFCCardInfo& info, bool reportUIDFirst) {
+  PN532Status status = _nfc->poll();
+  if (status == PN532Status::BUSY) {
+    return;
+  }
+  _readPhase = ReadPhase::IDLE;
+  _cardPresent = false; // Clear IRQ flag
+  bool autoPolled = _autoPolling;
+  endPoll();
+  
+  uint8_t uid[7] = {0};
+  uint8_t uidLength;
+  uint16_t atqa;
+  uint8_t sak;
+  unsigned long now = millis();
+  bool found = autoPolled ? _nfc->readAutoPollTarget(uid, &uidLength, &atqa, &sak)
+                          : _nfc->readPassiveTarget(uid, &uidLength, &atqa, &sak);
+  if (!found) {
+    // No card detected - check if card was removed
+    if (_readMode == NFCReadMode::POLLING && _lastCardPresent && (now - _lastCardDetectedTime > CARD_TIMEOUT)) {
+      _lastCardPresent = false;
+      Serial.println(F("NFC: Card removed"));
+    }
+    if (_readMode == NFCReadMode::POLLING && _fieldDutyCycling) {
+      _nfc->startRFField(false);
+      setFieldOn(false);
+      _readPhase = ReadPhase::FIELD_OFF;
+    }
+    return;
+  }
+  _lastActivityTime = now;
+  if (autoPolled) {
+    setFieldOn(true);  // The PN532 keeps the found target active
+  }
+  
+  // Check if this is the same card (debounce)
+  if (_lastCardPresent && (now - _lastCardDetectedTime < 1000)) {
+    // Same card still present, don't report again
+    return;
+  }
+  
+  // Detection latency: from the IRQ edge in IRQ mode, from the start of
+  // the search when polling; getAverageDetectionLatency() adds the wait
+  // for the search itself
+  unsigned long detectedFrom = _detectionStartMicros;
+  if (_readMode == NFCReadMode::IRQ) {
+    noInterrupts();
+    detectedFrom = _lastIRQMicros;
+    interrupts();
+  }
+  if (_detections < 0xFFFF) {
+    _detectionMicros += micros() - detectedFrom;
+    _detections++;
+  }
+  
+#ifdef TAP_TRACING
+  // The tap starts at the IRQ edge for this response, or at the poll
+  if (_readMode == NFCReadMode::IRQ) {
+    noInterrupts();
+    unsigned long edge = _lastIRQMicros;
+    interrupts();
+    TAP_TRACE_START(TracePoint::IRQ, edge);
+  } else {
+    TAP_TRACE_START(TracePoint::POLL, _detectionStartMicros);
+  }
+  TAP_TRACE(TracePoint::UID);
+#endif
+  
+  // Store for potential write operations
+  NFCCardInfo& card = _lastCardInfo;
+  memcpy(card.uid, uid, uidLength);
+  card.uidLength = uidLength;
+  card.detected = true;
+  card.cardType = determineCardType(sak);
+  card.cardID = calculateCardID(uid, uidLength);
+  card.atqa = atqa;
+  card.sak = sak;
+  card.storageSize = 0;
+  
+  // Initialize cloned UID fields
+  card.hasClonedUID = false;
+  card.clonedUIDLength = 0;
+  card.sectorPending = false;
+  card.cloneTimestamp = 0;
+  card.cloneFlags = 0;
+  memset(card.clonedUID, 0, 7);
+  
+  _lastCardDetectedTime = now;
+  _lastCardPresent = true;
+  
+  if (card.cardType == NFCCardType::MIFARE_ULTRALIGHT) {
+    _nfc->startNtagGetVersion();
+    _readPhase = ReadPhase::IDENTIFYING;
+    return;
+  }
+  
+  // Try to read custom sector data (for cloned UIDs)
+  // Only for Mifare Classic cards, and only if not cached
+  if ((card.cardType == NFCCardType::MIFARE_CLASSIC_1K || 
+       card.cardType == NFCCardType::MIFARE_CLASSIC_4K) &&
+      !lookupSectorCache(card)) {
+    if (reportUIDFirst) {
+      // Hand over the UID before spending any bus time on the sector
+      info = card;
+      info.sectorPending = true;
+      _readPhase = ReadPhase::UID_REPORTED;
+    } else {
+      startCustomSector();
+    }
+    return;
   }
+  
+  info = card;
+  printCardInfo(info);
+}
+
+void NFCReader::startCustomSector() {
+  _sectorUnreported = false;
+  _nfc->startMifareAuthenticate(CUSTOM_BLOCK_UID, 0, DEFAULT_KEY, _lastCardInfo.uid, _lastCardInfo.uidLength);
+  _readPhase = ReadPhase::AUTHENTICATING;
+}
+
+// Authenticate to block 4, then read it; the card is reported either way
+void NFCReader::pollCustomSector(NFCCardInfo& info) {
+  PN532Status status = _nfc->poll();
+  if (status == PN532Status::BUSY) {
+    return;
+  }
+  
+  if (_readPhase == ReadPhase::AUTHENTICATING) {
+    if (_nfc->readDataExchange(nullptr, 0)) {
+      _nfc->startMifareRead(CUSTOM_BLOCK_UID);
+      _readPhase = ReadPhase::READING;
+      return;
+    }
+    Serial.println(F("Custom sector auth failed"));
+  } else {
+    uint8_t blockData[16];
+    if (_nfc->readDataExchange(blockData, 16)) {
+      decodeCustomSector(_lastCardInfo, blockData);
+    } else {
+      Serial.println(F("Custom sector read failed"));
+    }
+  }
+  
+  _readPhase = ReadPhase::IDLE;
+  if (_sectorUnreported) {
+    _sectorUnreported = false;
+    return;  // Already decided on the physical UID
+  }
+  TAP_TRACE(TracePoint::SECTOR);
+  info = _lastCardInfo;
+  printCardInfo(info);
+}
+
+// GET_VERSION reply for a SAK 0x00 tag; the card is reported either way
+void NFCReader::pollIdentification(NFCCardInfo& info) {
+  PN532Status status = _nfc->poll();
+  if (status == PN532Status::BUSY) {
+    return;
+  }
+  
+  if (_readPhase == ReadPhase::IDENTIFYING) {
+    uint8_t version[NTAG_VERSION_LENGTH];
+    if (!_nfc->readDataExchange(version, NTAG_VERSION_LENGTH)) {
+      // Original Ultralight and Ultralight C NAK GET_VERSION and halt, so
+      // select the tag again before anyone reads or writes it
+      _nfc->startListPassiveTarget(NFC_POLL_TIMEOUT);
+      _readPhase = ReadPhase::RESELECTING;
+      return;
+    }
+    if (version[2] == NTAG_PRODUCT_NTAG) {
+      _lastCardInfo.cardType = NFCCardType::NTAG;
+    }
+    _lastCardInfo.storageSize = version[6];
+  }
+  
+  _readPhase = ReadPhase::IDLE;
+  info = _lastCardInfo;
+  printCardInfo(info);
+}
+
+// The field was already counted off when the command went out
+void NFCReader::pollFieldOff() {
+  if (_nfc->poll() == PN532Status::BUSY) {
+    return;
+  }
+  _readPhase = ReadPhase::IDLE;
+}
+
+// The physical UID was enough. Keep reading the custom sector so the
+// cache has it for the next tap, but don't report the card again.
+void NFCReader::skipCustomSector() {
+  if (_readPhase == ReadPhase::UID_REPORTED) {
+    startCustomSector();
+    _sectorUnreported = true;
+  }
+}
+
+// Drop a read in flight so a blocking command can use the PN532
+void NFCReader::cancelRead() {
+  if (_readPhase != ReadPhase::IDLE) {
+    if (_readPhase == ReadPhase::DETECTING) {
+      endPoll();
+    }
+    _nfc->abort();
+    _readPhase = ReadPhase::IDLE;
+  }
+}
+
+// ========== POLL SCHEDULER ==========
+
+// Pick the poll interval and roll the duty cycle window
+void NFCReader::schedulePoll(unsigned long now) {
+  _pollInterval = now - _lastActivityTime < NFC_POLL_IDLE_AFTER ? NFC_POLL_FAST_INTERVAL : NFC_POLL_SLOW_INTERVAL;
+  
+  unsigned long elapsed = now - _pollWindowStart;
+  if (elapsed >= NFC_POLL_WINDOW) {
+    _pollDutyCycle = (uint8_t)min(100UL, _pollBusyMicros / (elapsed * 10));
+    _pollBusyMicros = 0;
+    _pollWindowStart = now;
+  }
+}
+
+// Charge the search that just ended to the current window, or the
+// InAutoPoll slots to the field on time
+void NFCReader::endPoll() {
+  if (_readMode == NFCReadMode::POLLING) {
+    unsigned long window = micros() - _detectionStartMicros;
+    _pollBusyMicros += window;
+    _pollWindowMicros = _pollWindowMicros ? (_pollWindowMicros * 7 + window) / 8 : window;
+  } else if (_autoPolling) {
+    _fieldOnMillis += autoPollFieldMillis(millis());
+    _autoPolling = false;
+  }
+}
+
+// ========== RF FIELD ==========
+
+// Only polls are bounded; the armed IRQ search has to wait for a card
+bool NFCReader::setPassiveActivationRetries(uint8_t retries) {
+  _passiveRetries = retries;
+  if (!_nfc || _readMode != NFCReadMode::POLLING) {
+    return true;  // Applied by begin()
+  }
+  cancelRead();
+  return _nfc->setPassiveActivationRetries(retries);
+}
+
+void NFCReader::setFieldOn(bool on) {
+  unsigned long now = millis();
+  if (_fieldOn && !on) {
+    _fieldOnMillis += now - _fieldOnSince;
+  } else if (!_fieldOn && on) {
+    _fieldOnSince = now;
+  }
+  _fieldOn = on;
+}
+
+// InAutoPoll keeps the field on for one activation per slot
+unsigned long NFCReader::autoPollFieldMillis(unsigned long now) {
+  unsigned long slots = (now - _autoPollStart) / (_autoPollPeriod * 150UL) + 1;
+  return slots * NFC_ACTIVATION_MICROS / 1000;
+}
+
+uint16_t NFCReader::getFieldOnSecondsPerHour() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - _fieldStatsStart;
+  if (elapsed == 0) {
+    return 0;
+  }
+  unsigned long onMillis = _fieldOnMillis;
+  if (_fieldOn) {
+    onMillis += now - _fieldOnSince;
+  }
+  if (_autoPolling) {
+    onMillis += autoPollFieldMillis(now);
+  }
+  return (uint16_t)min(3600ULL, (uint64_t)onMillis * 3600 / elapsed);
+}
+
+// Measured part plus the expected wait before a search notices the card:
+// a card landing in the gap between polls waits gap^2 / (2 x interval)
+// on average, InAutoPoll half a period
+uint32_t NFCReader::getAverageDetectionLatency() {
+  uint32_t expected = 0;
+  if (_readMode == NFCReadMode::POLLING) {
+    uint32_t interval = _pollInterval * 1000UL;
+    if (_pollWindowMicros < interval) {
+      uint32_t gap = interval - _pollWindowMicros;
+      expected = (uint32_t)((uint64_t)gap * gap / (2 * interval));
+    }
+  } else if (_autoPollPeriod) {
+    expected = _autoPollPeriod * 75000UL;
+  }
+  return (_detections ? _detectionMicros / _detections : 0) + expected;
+}
+
+void NFCReader::resetFieldStats() {
+  unsigned long now = millis();
+  _fieldStatsStart = now;
+  _fieldOnMillis = 0;
+  _fieldOnSince = now;
+  if (_autoPolling) {
+    _autoPollStart = now;
+  }
+  _detectionMicros = 0;
+  _detections = 0;
+}
+
+void NFCReader::printPollStats() {
+  Serial.print(F("Poll "));
+  Serial.print(getPollInterval());
+  Serial.print(F(" ms, duty "));
+  Serial.print(getPollDutyCycle());
+  Serial.print(F("%, field "));
+  Serial.print(getFieldOnSecondsPerHour());
+  Serial.print(F(" s/h, detect "));
+  Serial.print(getAverageDetectionLatency() / 1000);
+  Serial.println(F(" ms"));
+}
+
+// ========== BUS STATS ==========
+
+PN532BusStats NFCReader::getBusStats() const {
+  return _nfc ? _nfc->busStats() : PN532BusStats();
+}
+
+PN532BusStats NFCReader::getCommandBusStats() const {
+  return _nfc ? _nfc->commandBusStats() : PN532BusStats();
+}
+
+void NFCReader::resetBusStats() {
+  if (_nfc) {
+    _nfc->resetBusStats();
+  }
+}
+
+void NFCReader::printBusStats() {
+  PN532BusStats total = getBusStats();
+  PN532BusStats last = getCommandBusStats();
+  Serial.print(F("Bus "));
+  Serial.print(total.bytes);
+  Serial.print(F(" B "));
+  Serial.print(total.micros);
+  Serial.print(F(" us in "));
+  Serial.print(total.transactions);
+  Serial.print(F(", last cmd "));
+  Serial.print(last.bytes);
+  Serial.print(F(" B "));
+  Serial.print(last.micros);
+  Serial.println(F(" us"));
 }
 
 // ========== WRITE METHODS ==========
@@ -316,8 +765,7 @@ bool NFCReader::isCardPresent() {
 // Helper: Authenticate to Mifare Classic block
 bool NFCReader::authenticateMifareBlock(uint8_t block, const uint8_t* key, bool useKeyB, const uint8_t* uid, uint8_t uidLength) {
   uint8_t keyType = useKeyB ? 1 : 0;  // 0 = Key A, 1 = Key B
-  // Library expects non-const pointers, but doesn't modify the data
-  return _nfc->mifareclassic_AuthenticateBlock((uint8_t*)uid, uidLength, block, keyType, (uint8_t*)key);
+  return _nfc->mifareAuthenticate(block, keyType, key, uid, uidLength);
 }
 
 // Helper: Verify write by comparing data
@@ -332,20 +780,50 @@ bool NFCReader::verifyWrite(const uint8_t* expected, const uint8_t* actual, uint
 
 // Read NTAG/Ultralight page (4 bytes)
 bool NFCReader::readNTAGPage(uint8_t page, uint8_t* buffer) {
+  return readNTAGPages(page, 1, buffer);
+}
+
+// Read consecutive NTAG/Ultralight pages
+bool NFCReader::readNTAGPages(uint8_t startPage, uint8_t count, uint8_t* buffer) {
   if (!_nfc) return false;
+  cancelRead();
   
-  // NTAG read returns 16 bytes (4 pages), we need first 4 bytes
-  uint8_t data[32];
-  if (_nfc->mifareultralight_ReadPage(page, data)) {
-    memcpy(buffer, data, 4);
-    return true;
+  // Ultralight answers FAST_READ by dropping out of the selected state,
+  // so only NTAG gets it
+  bool fastRead = _lastCardInfo.detected && _lastCardInfo.cardType == NFCCardType::NTAG;
+  uint8_t page = startPage;
+  uint8_t remaining = count;
+  
+  while (remaining > 0) {
+    if (fastRead && remaining > 4) {
+      uint8_t pages = min(remaining, (uint8_t)NTAG_FAST_READ_PAGES);
+      if (!_nfc->ntagFastRead(page, page + pages - 1, buffer)) {
+        return false;
+      }
+      page += pages;
+      remaining -= pages;
+      buffer += pages * 4;
+      continue;
+    }
+  
+    // READ returns 4 pages (16 bytes) starting at page
+    uint8_t data[16];
+    if (!_nfc->mifareReadBlock(page, data)) {
+      return false;
+    }
+    uint8_t pages = min(remaining, (uint8_t)4);
+    memcpy(buffer, data, pages * 4);
+    page += pages;
+    remaining -= pages;
+    buffer += pages * 4;
   }
-  return false;
+  return true;
 }
 
 // Read Mifare Classic block (16 bytes)
 bool NFCReader::readMifareClassicBlock(uint8_t block, uint8_t* buffer, const uint8_t* key, bool useKeyB) {
   if (!_nfc || !_lastCardInfo.detected) return false;
+  cancelRead();
   
   // Authenticate first
   if (!authenticateMifareBlock(block, key, useKeyB, _lastCardInfo.uid, _lastCardInfo.uidLength)) {
@@ -353,7 +831,33 @@ bool NFCReader::readMifareClassicBlock(uint8_t block, uint8_t* buffer, const uin
   }
   
   // Read block
-  return _nfc->mifareclassic_ReadDataBlock(block, buffer);
+  return _nfc->mifareReadBlock(block, buffer);
+}
+
+bool NFCReader::readMifareClassicSector(uint8_t sector, uint8_t* buffer, const uint8_t* key, bool useKeyB) {
+  if (!_nfc || !_lastCardInfo.detected) return false;
+  cancelRead();
+  return readSectorBlocks(sector, buffer, key, useKeyB, _lastCardInfo.uid, _lastCardInfo.uidLength);
+}
+
+bool NFCReader::readSectorBlocks(uint8_t sector, uint8_t* buffer, const uint8_t* key, bool useKeyB,
+                                 const uint8_t* uid, uint8_t uidLength) {
+  if (sector >= 40) return false;
+  
+  uint8_t firstBlock = MIFARE_SECTOR_FIRST_BLOCK(sector);
+  uint8_t blocks = MIFARE_SECTOR_DATA_BLOCKS(sector);
+  
+  // One authentication covers every block of the sector
+  if (!authenticateMifareBlock(firstBlock, key, useKeyB, uid, uidLength)) {
+    return false;
+  }
+  
+  for (uint8_t i = 0; i < blocks; i++) {
+    if (!_nfc->mifareReadBlock(firstBlock + i, buffer + i * 16)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 // Write to NTAG/Ultralight page
@@ -366,6 +870,7 @@ NFCWriteResult NFCReader::writeNTAG(uint8_t page, const uint8_t* data, uint8_t d
     result.errorMessage = "NFC not initialized";
     return result;
   }
+  cancelRead();
   
   // Allow pages 0-1 write for magic cards (will fail on regular cards)
   // Pages 0-1 contain UID - only works on special writable UID cards
@@ -380,13 +885,13 @@ NFCWriteResult NFCReader::writeNTAG(uint8_t page, const uint8_t* data, uint8_t d
   memcpy(pageData, data, dataLength);
   
   // Write to page
-  if (_nfc->mifareultralight_WritePage(page, pageData)) {
+  if (_nfc->ultralightWritePage(page, pageData)) {
     result.success = true;
     
     // Verify if requested
     if (verify) {
       uint8_t readBack[4];
-      if (readNTAGPage(page, readBack)) {
+      if (readNTAGPages(page, 1, readBack)) {
         result.verified = verifyWrite(pageData, readBack, 4);
         if (!result.verified) {
           result.errorMessage = "Write succeeded but verification failed";
@@ -403,34 +908,80 @@ NFCWriteResult NFCReader::writeNTAG(uint8_t page, const uint8_t* data, uint8_t d
 }
 
 // Write string to NTAG/Ultralight
-NFCWriteResult NFCReader::writeNTAGString(uint8_t startPage, const String& text, bool verify) {
+NFCWriteResult NFCReader::writeNTAGString(uint8_t startPage, const String& text, bool verify, bool deferVerify) {
+  return writeNTAGPages(startPage, (const uint8_t*)text.c_str(), text.length(), verify, deferVerify);
+}
+
+// Write consecutive NTAG/Ultralight pages, zero padding the last one
+NFCWriteResult NFCReader::writeNTAGPages(uint8_t startPage, const uint8_t* data, uint8_t dataLength,
+                                         bool verify, bool deferVerify) {
   NFCWriteResult result;
   result.success = true;
-  result.verified = true;
+  result.verified = verify;
+  result.firstPage = startPage;
   
-  uint8_t textLength = text.length();
   uint8_t page = startPage;
-  
-  for (uint8_t i = 0; i < textLength; i += 4) {
-    uint8_t chunkSize = min(4, textLength - i);
-    NFCWriteResult pageResult = writeNTAG(page, (const uint8_t*)(text.c_str() + i), chunkSize, verify);
+  for (uint8_t i = 0; i < dataLength; i += 4) {
+    uint8_t chunkSize = min(4, dataLength - i);
+    NFCWriteResult pageResult = writeNTAG(page, data + i, chunkSize, verify && !deferVerify);
     
     if (!pageResult.success) {
       result.success = false;
+      result.verified = false;
       result.errorMessage = "Failed at page " + String(page) + ": " + pageResult.errorMessage;
       return result;
     }
     
-    if (verify && !pageResult.verified) {
+    if (verify && !deferVerify && !pageResult.verified) {
       result.verified = false;
+      result.failedPages |= (uint64_t)1 << (page - startPage);
+      result.errorMessage = pageResult.errorMessage;
     }
     
     page++;
   }
   
+  if (verify && deferVerify) {
+    verifyNTAGPages(result, data, dataLength);
+  }
+  
   return result;
 }
 
+// Read back the pages of a finished write, several per transaction, and
+// flag every page that does not match
+void NFCReader::verifyNTAGPages(NFCWriteResult& result, const uint8_t* data, uint8_t dataLength) {
+  uint8_t pageCount = (dataLength + 3) / 4;
+  uint8_t stride = _lastCardInfo.cardType == NFCCardType::NTAG ? NTAG_FAST_READ_PAGES : 4;
+  uint8_t readBack[NTAG_FAST_READ_PAGES * 4];
+  
+  for (uint8_t first = 0; first < pageCount; first += stride) {
+    uint8_t pages = min(stride, (uint8_t)(pageCount - first));
+    bool readOK = readNTAGPages(result.firstPage + first, pages, readBack);
+  
+    for (uint8_t i = 0; i < pages; i++) {
+      uint8_t index = first + i;
+      uint8_t expected[4] = {0};
+      memcpy(expected, data + index * 4, min(4, dataLength - index * 4));
+  
+      if (!readOK || !verifyWrite(expected, readBack + i * 4, 4)) {
+        result.failedPages |= (uint64_t)1 << index;
+      }
+    }
+  
+    if (!readOK && result.errorMessage.length() == 0) {
+      result.errorMessage = "Write succeeded but couldn't read back page " + String(result.firstPage + first);
+    }
+  }
+  
+  if (result.failedPages != 0) {
+    result.verified = false;
+    if (result.errorMessage.length() == 0) {
+      result.errorMessage = "Write succeeded but verification failed";
+    }
+  }
+}
+
 // Write to Mifare Classic block
 NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data, uint8_t dataLength, 
                                               const uint8_t* key, bool useKeyB, bool verify) {
@@ -442,12 +993,13 @@ NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data,
     result.errorMessage = "No card detected";
     return result;
   }
+  cancelRead();
   
   // Allow block 0 write for magic cards (will fail on regular cards)
   // Block 0 contains UID - only works on special writable UID cards
   
   // Check if this is a trailer block (last block of sector) - still dangerous
-  if (block != 0 && (block + 1) % 4 == 0) {
+  if (MIFARE_IS_TRAILER(block)) {
     result.errorMessage = "Block " + String(block) + " is a sector trailer (contains keys). Writing to trailers is dangerous!";
     return result;
   }
@@ -461,6 +1013,10 @@ NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data,
   uint8_t blockData[16] = {0};
   memcpy(blockData, data, dataLength);
   
+  if (block == CUSTOM_BLOCK_UID) {
+    invalidateSectorCache(_lastCardInfo.uid, _lastCardInfo.uidLength);
+  }
+  
   // Authenticate
   if (!authenticateMifareBlock(block, key, useKeyB, _lastCardInfo.uid, _lastCardInfo.uidLength)) {
     result.errorMessage = "Authentication failed for block " + String(block);
@@ -468,7 +1024,7 @@ NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data,
   }
   
   // Write block
-  if (_nfc->mifareclassic_WriteDataBlock(block, blockData)) {
+  if (_nfc->mifareWriteBlock(block, blockData)) {
     result.success = true;
     
     // Verify if requested
@@ -476,7 +1032,7 @@ NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data,
       // Re-authenticate for reading
       if (authenticateMifareBlock(block, key, useKeyB, _lastCardInfo.uid, _lastCardInfo.uidLength)) {
         uint8_t readBack[16];
-        if (_nfc->mifareclassic_ReadDataBlock(block, readBack)) {
+        if (_nfc->mifareReadBlock(block, readBack)) {
           result.verified = verifyWrite(blockData, readBack, 16);
           if (!result.verified) {
             result.errorMessage = "Write succeeded but verification failed";
@@ -498,41 +1054,79 @@ NFCWriteResult NFCReader::writeMifareClassic(uint8_t block, const uint8_t* data,
 // Write string to Mifare Classic
 NFCWriteResult NFCReader::writeMifareClassicString(uint8_t startBlock, const String& text, 
                                                      const uint8_t* key, bool useKeyB, bool verify) {
+  return writeMifareClassicBlocks(startBlock, (const uint8_t*)text.c_str(), text.length(), key, useKeyB, verify);
+}
+
+// Write consecutive Mifare Classic data blocks, one authentication per sector
+NFCWriteResult NFCReader::writeMifareClassicBlocks(uint8_t startBlock, const uint8_t* data, uint16_t dataLength,
+                                                    const uint8_t* key, bool useKeyB, bool verify) {
   NFCWriteResult result;
-  result.success = true;
-  result.verified = true;
+  result.success = false;
+  result.verified = false;
+  
+  if (!_nfc || !_lastCardInfo.detected) {
+    result.errorMessage = "No card detected";
+    return result;
+  }
+  cancelRead();
   
-  uint8_t textLength = text.length();
-  uint8_t block = startBlock;
+  uint16_t block = startBlock;
+  uint16_t offset = 0;
+  bool verified = true;
   
-  for (uint8_t i = 0; i < textLength; i += 16) {
-    // Skip trailer blocks
-    if ((block + 1) % 4 == 0) {
+  while (offset < dataLength) {
+    if (MIFARE_IS_TRAILER(block)) {
       block++;
     }
-    
-    uint8_t chunkSize = min(16, textLength - i);
-    NFCWriteResult blockResult = writeMifareClassic(block, (const uint8_t*)(text.c_str() + i), 
-                                                     chunkSize, key, useKeyB, verify);
-    
-    if (!blockResult.success) {
-      result.success = false;
-      result.errorMessage = "Failed at block " + String(block) + ": " + blockResult.errorMessage;
+    if (block > 255) {
+      result.errorMessage = "Data runs past the last block";
       return result;
     }
-    
-    if (verify && !blockResult.verified) {
-      result.verified = false;
+  
+    if (MIFARE_BLOCK_SECTOR(block) == CUSTOM_SECTOR) {
+      invalidateSectorCache(_lastCardInfo.uid, _lastCardInfo.uidLength);
+    }
+  
+    if (!authenticateMifareBlock(block, key, useKeyB, _lastCardInfo.uid, _lastCardInfo.uidLength)) {
+      result.errorMessage = "Authentication failed for block " + String(block);
+      return result;
+    }
+  
+    // Every block of this sector the data reaches, in the same session
+    while (offset < dataLength && !MIFARE_IS_TRAILER(block)) {
+      uint8_t chunkSize = min((uint16_t)16, (uint16_t)(dataLength - offset));
+      uint8_t blockData[16] = {0};
+      memcpy(blockData, data + offset, chunkSize);
+  
+      if (!_nfc->mifareWriteBlock(block, blockData)) {
+        result.errorMessage = "Write operation failed for block " + String(block);
+        return result;
+      }
+  
+      if (verify && verified) {
+        uint8_t readBack[16];
+        if (!_nfc->mifareReadBlock(block, readBack)) {
+          verified = false;
+          result.errorMessage = "Write succeeded but couldn't read back block " + String(block);
+        } else if (!verifyWrite(blockData, readBack, 16)) {
+          verified = false;
+          result.errorMessage = "Write succeeded but verification failed for block " + String(block);
+        }
+      }
+  
+      offset += chunkSize;
+      block++;
     }
-    
-    block++;
   }
   
+  result.success = true;
+  result.verified = verify && verified;
   return result;
 }
 
 // Generic write that auto-detects card type
-NFCWriteResult NFCReader::writeData(const uint8_t* data, uint8_t dataLength, uint8_t startAddress, bool verify) {
+NFCWriteResult NFCReader::writeData(const uint8_t* data, uint8_t dataLength, uint8_t startAddress,
+                                    bool verify, bool deferVerify) {
   NFCWriteResult result;
   
   if (!_lastCardInfo.detected) {
@@ -545,47 +1139,18 @@ NFCWriteResult NFCReader::writeData(const uint8_t* data, uint8_t dataLength, uin
       _lastCardInfo.cardType == NFCCardType::MIFARE_CLASSIC_4K) {
     // Mifare Classic - startAddress is block number
     uint8_t block = startAddress == 0 ? 4 : startAddress; // Default to block 4 (first data block in sector 1)
-    
-    // Write in 16-byte chunks
-    uint8_t numBlocks = (dataLength + 15) / 16;
-    for (uint8_t i = 0; i < numBlocks; i++) {
-      uint8_t currentBlock = block + i;
-      
-      // Skip trailer blocks
-      if ((currentBlock + 1) % 4 == 0) {
-        currentBlock++;
-      }
-      
-      uint8_t offset = i * 16;
-      uint8_t chunkSize = min(16, dataLength - offset);
-      
-      result = writeMifareClassic(currentBlock, data + offset, chunkSize, DEFAULT_KEY, false, verify);
-      if (!result.success) {
-        return result;
-      }
-    }
+    result = writeMifareClassicBlocks(block, data, dataLength, DEFAULT_KEY, false, verify);
   } else {
     // NTAG/Ultralight - startAddress is page number
     uint8_t page = startAddress == 0 ? 4 : startAddress; // Default to page 4 (safe user area)
-    
-    // Write in 4-byte chunks
-    uint8_t numPages = (dataLength + 3) / 4;
-    for (uint8_t i = 0; i < numPages; i++) {
-      uint8_t offset = i * 4;
-      uint8_t chunkSize = min(4, dataLength - offset);
-      
-      result = writeNTAG(page + i, data + offset, chunkSize, verify);
-      if (!result.success) {
-        return result;
-      }
-    }
+    result = writeNTAGPages(page, data, dataLength, verify, deferVerify);
   }
   
   return result;
 }
 
 // Generic write string
-NFCWriteResult NFCReader::writeString(const String& text, uint8_t startAddress, bool verify) {
+NFCWriteResult NFCReader::writeString(const String& text, uint8_t startAddress, bool verify, bool deferVerify) {
   if (!_lastCardInfo.detected) {
     NFCWriteResult result;
     result.success = false;
@@ -599,7 +1164,7 @@ NFCWriteResult NFCReader::writeString(const String& text, uint8_t startAddress,
     return writeMifareClassicString(block, text, DEFAULT_KEY, false, verify);
   } else {
     uint8_t page = startAddress == 0 ? 4 : startAddress;
-    return writeNTAGString(page, text, verify);
+    return writeNTAGString(page, text, verify, deferVerify);
   }
 }
 
@@ -616,27 +1181,52 @@ bool NFCReader::readCustomSector(NFCCardInfo& info) {
       info.cardType != NFCCardType::MIFARE_CLASSIC_4K) {
     return false;
   }
+  cancelRead();
   
-  // Authenticate to block 4 (first block of sector 1)
-  if (!authenticateMifareBlock(CUSTOM_BLOCK_UID, DEFAULT_KEY, false, info.uid, info.uidLength)) {
-    Serial.println(F("Custom sector auth failed"));
-    return false;
-  }
-  
-  // Read block 4 (UID block)
-  uint8_t blockData[16];
-  if (!_nfc->mifareclassic_ReadDataBlock(CUSTOM_BLOCK_UID, blockData)) {
+  // Blocks 4-6 in one authenticated session
+  uint8_t sectorData[MIFARE_SECTOR_DATA_BLOCKS(CUSTOM_SECTOR) * 16];
+  if (!readSectorBlocks(CUSTOM_SECTOR, sectorData, DEFAULT_KEY, false, info.uid, info.uidLength)) {
     Serial.println(F("Custom sector read failed"));
     return false;
   }
   
+  const uint8_t* uidBlock = sectorData;
+  const uint8_t* metadataBlock = sectorData + (CUSTOM_BLOCK_DATA - CUSTOM_BLOCK_UID) * 16;
+  decodeCloneMetadata(info, uidBlock, metadataBlock);
+  return decodeCustomSector(info, uidBlock);
+}
+
+// XOR of the UID block, kept in block 5 so stale metadata is ignored
+static uint8_t uidBlockChecksum(const uint8_t* uidBlock) {
+  uint8_t checksum = 0;
+  for (uint8_t i = 0; i < 16; i++) {
+    checksum ^= uidBlock[i];
+  }
+  return checksum;
+}
+
+// Metadata counts only if it is flagged valid and matches block 4
+void NFCReader::decodeCloneMetadata(NFCCardInfo& info, const uint8_t* uidBlock, const uint8_t* metadataBlock) {
+  if ((metadataBlock[4] & CLONE_FLAG_VALID) && metadataBlock[5] == uidBlockChecksum(uidBlock)) {
+    info.cloneTimestamp = ((uint32_t)metadataBlock[0] << 24) | ((uint32_t)metadataBlock[1] << 16) |
+                          ((uint32_t)metadataBlock[2] << 8) | metadataBlock[3];
+    info.cloneFlags = metadataBlock[4];
+  } else {
+    info.cloneTimestamp = 0;
+    info.cloneFlags = 0;
+  }
+}
+
+// Fill in the cloned UID from block 4 and cache the result
+bool NFCReader::decodeCustomSector(NFCCardInfo& info, const uint8_t* blockData) {
   // Check magic bytes
   if (blockData[0] == CARD_MAGIC_BYTE1 && blockData[1] == CARD_MAGIC_BYTE2) {
     // Card is initialized with our custom data
     info.hasClonedUID = true;
     info.clonedUIDLength = blockData[2]; // UID length stored in byte 2
     
-    if (info.clonedUIDLength > 0 && info.clonedUIDLength <= 7) {
+    // Only 4- and 7-byte UIDs can be registered
+    if (info.clonedUIDLength == 4 || info.clonedUIDLength == 7) {
       // Copy cloned UID (bytes 3-9)
       memcpy(info.clonedUID, &blockData[3], info.clonedUIDLength);
       
@@ -648,17 +1238,20 @@ bool NFCReader::readCustomSector(NFCCardInfo& info) {
       }
       Serial.println();
       
+      storeSectorCache(info);
       return true;
     }
   }
   
-  // No valid custom data found
+  // No valid custom data found - also worth caching
   info.hasClonedUID = false;
+  info.clonedUIDLength = 0;
+  storeSectorCache(info);
   return false;
 }
 
-// Write cloned UID to custom sector
-bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength) {
+// Write cloned UID to block 4 and its metadata to block 5
+bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength, uint32_t timestamp) {
   if (!_nfc || !_lastCardInfo.detected) {
     Serial.println(F("No card for clone write"));
     return false;
@@ -671,10 +1264,11 @@ bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength
     return false;
   }
   
-  if (sourceUIDLength > 7) {
-    Serial.println(F("UID too long"));
+  if (sourceUIDLength != 4 && sourceUIDLength != 7) {
+    Serial.println(F("UID must be 4 or 7 bytes"));
     return false;
   }
+  cancelRead();
   
   Serial.print(F("Writing cloned UID to block "));
   Serial.print(CUSTOM_BLOCK_UID);
@@ -686,6 +1280,9 @@ bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength
   }
   Serial.println();
   
+  // Whatever happens below, the cached result for this card is stale
+  invalidateSectorCache(_lastCardInfo.uid, _lastCardInfo.uidLength);
+  
   // Prepare block data
   // Format: [Magic1][Magic2][UIDLen][UID0-6][Reserved bytes]
   uint8_t blockData[16] = {0};
@@ -695,18 +1292,32 @@ bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength
   memcpy(&blockData[3], sourceUID, sourceUIDLength);
   // Bytes 10-15 reserved for future use
   
-  // Authenticate to block 4
+  // Metadata: [timestamp x4][flags][block 4 checksum][reserved...]
+  uint8_t metadata[16] = {0};
+  metadata[0] = timestamp >> 24;
+  metadata[1] = timestamp >> 16;
+  metadata[2] = timestamp >> 8;
+  metadata[3] = timestamp;
+  metadata[4] = CLONE_FLAG_VALID;
+  metadata[5] = uidBlockChecksum(blockData);
+  
+  // Authenticate to sector 1
   if (!authenticateMifareBlock(CUSTOM_BLOCK_UID, DEFAULT_KEY, false, 
                                 _lastCardInfo.uid, _lastCardInfo.uidLength)) {
     Serial.println(F("Auth failed for clone write"));
     return false;
   }
   
-  // Write to block 4
-  if (!_nfc->mifareclassic_WriteDataBlock(CUSTOM_BLOCK_UID, blockData)) {
+  // Write block 4, then block 5 in the same session. Block 5 is written
+  // second, so if it is left stale its checksum won't match.
+  if (!_nfc->mifareWriteBlock(CUSTOM_BLOCK_UID, blockData)) {
     Serial.println(F("Clone write failed"));
     return false;
   }
+  if (!_nfc->mifareWriteBlock(CUSTOM_BLOCK_DATA, metadata)) {
+    Serial.println(F("Clone metadata write failed"));
+    return false;
+  }
   
   Serial.println(F("Clone write SUCCESS"));
   
@@ -714,7 +1325,7 @@ bool NFCReader::writeClonedUID(const uint8_t* sourceUID, uint8_t sourceUIDLength
   if (authenticateMifareBlock(CUSTOM_BLOCK_UID, DEFAULT_KEY, false, 
                               _lastCardInfo.uid, _lastCardInfo.uidLength)) {
     uint8_t readBack[16];
-    if (_nfc->mifareclassic_ReadDataBlock(CUSTOM_BLOCK_UID, readBack)) {
+    if (_nfc->mifareReadBlock(CUSTOM_BLOCK_UID, readBack)) {
       // Check if data matches
       bool verified = true;
       for (uint8_t i = 0; i < 10; i++) { // Check first 10 bytes (magic + len + UID)
@@ -758,7 +1369,10 @@ bool NFCReader::initializeCard() {
     return false;
   }
   
+  cancelRead();
+  
   Serial.println(F("Initializing card..."));
+  invalidateSectorCache(_lastCardInfo.uid, _lastCardInfo.uidLength);
   
   // Prepare empty block with magic bytes but no UID
   uint8_t blockData[16] = {0};
@@ -774,7 +1388,7 @@ bool NFCReader::initializeCard() {
   }
   
   // Write to block 4
-  if (!_nfc->mifareclassic_WriteDataBlock(CUSTOM_BLOCK_UID, blockData)) {
+  if (!_nfc->mifareWriteBlock(CUSTOM_BLOCK_UID, blockData)) {
     Serial.println(F("Init write failed"));
     return false;
   }
@@ -782,3 +1396,81 @@ bool NFCReader::initializeCard() {
   Serial.println(F("Card initialized"));
   return true;
 }
+
+// ========== CUSTOM SECTOR CACHE ==========
+
+void NFCReader::clearSectorCache() {
+  for (uint8_t i = 0; i < NFC_SECTOR_CACHE_SIZE; i++) {
+    _sectorCache[i].uidLength = 0;
+  }
+}
+
+// Fill in the cloned UID fields from the cache; false on miss or expiry
+bool NFCReader::lookupSectorCache(NFCCardInfo& info) {
+  if (NFC_SECTOR_CACHE_TTL == 0) {
+    return false;
+  }
+  
+  int8_t index = findSectorCacheEntry(info.uid, info.uidLength);
+  if (index < 0 || millis() - _sectorCache[index].storedAt >= NFC_SECTOR_CACHE_TTL) {
+    _sectorCacheMisses++;
+    return false;
+  }
+  
+  SectorCacheEntry& entry = _sectorCache[index];
+  info.hasClonedUID = entry.clonedUIDLength > 0;
+  info.clonedUIDLength = entry.clonedUIDLength;
+  memcpy(info.clonedUID, entry.clonedUID, entry.clonedUIDLength);
+  _lastCardInfo = info;
+  
+  promoteSectorCacheEntry(index);
+  _sectorCacheHits++;
+  return true;
+}
+
+void NFCReader::storeSectorCache(const NFCCardInfo& info) {
+  if (NFC_SECTOR_CACHE_TTL == 0) {
+    return;
+  }
+  
+  // Reuse this card's entry, otherwise evict the least recently used one
+  int8_t index = findSectorCacheEntry(info.uid, info.uidLength);
+  if (index < 0) {
+    index = NFC_SECTOR_CACHE_SIZE - 1;
+  }
+  
+  SectorCacheEntry& entry = _sectorCache[index];
+  memcpy(entry.uid, info.uid, info.uidLength);
+  entry.uidLength = info.uidLength;
+  entry.clonedUIDLength = info.hasClonedUID ? info.clonedUIDLength : 0;
+  memcpy(entry.clonedUID, info.clonedUID, entry.clonedUIDLength);
+  entry.storedAt = millis();
+  
+  promoteSectorCacheEntry(index);
+}
+
+void NFCReader::invalidateSectorCache(const uint8_t* uid, uint8_t uidLength) {
+  int8_t index = findSectorCacheEntry(uid, uidLength);
+  if (index >= 0) {
+    _sectorCache[index].uidLength = 0;
+  }
+}
+
+int8_t NFCReader::findSectorCacheEntry(const uint8_t* uid, uint8_t uidLength) {
+  for (uint8_t i = 0; i < NFC_SECTOR_CACHE_SIZE; i++) {
+    if (_sectorCache[i].uidLength == uidLength && memcmp(_sectorCache[i].uid, uid, uidLength) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Move an entry to the front, shifting the more recent ones down
+void NFCReader::promoteSectorCacheEntry(uint8_t index) {
+  if (index == 0) {
+    return;
+  }
+  SectorCacheEntry entry = _sectorCache[index];
+  memmove(&_sectorCache[1], &_sectorCache[0], index * sizeof(SectorCacheEntry));
+  _sectorCache[0] = entry;
+}
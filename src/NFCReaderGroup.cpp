@@ -0,0 +1,53 @@
+#include "NFCReaderGroup.h"
+
+NFCReaderGroup::NFCReaderGroup()
+  : _count(0),
+    _last(0)
+{
+}
+
+bool NFCReaderGroup::add(NFCReader& reader) {
+  if (_count >= NFC_MAX_READERS) {
+    return false;
+  }
+  _readers[_count++] = &reader;
+  return true;
+}
+
+bool NFCReaderGroup::begin() {
+  // Park every chip select first, or traffic to the first reader also
+  // reaches PN532s on the same bus whose SS pin is still floating
+  for (uint8_t i = 0; i < _count; i++) {
+    _readers[i]->releaseChipSelect();
+  }
+  
+  bool ok = _count > 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    if (!_readers[i]->begin()) {
+      Serial.print(F("NFC reader "));
+      Serial.print(i);
+      Serial.println(F(" failed"));
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+NFCCardInfo NFCReaderGroup::readCard(bool reportUIDFirst) {
+  if (_count > 1) {
+    _last = (_last + 1) % _count;
+  }
+  return _readers[_last]->readCard(reportUIDFirst);
+}
+
+void NFCReaderGroup::notifyActivity() {
+  for (uint8_t i = 0; i < _count; i++) {
+    _readers[i]->notifyActivity();
+  }
+}
+
+void NFCReaderGroup::resetCardState() {
+  for (uint8_t i = 0; i < _count; i++) {
+    _readers[i]->resetCardState();
+  }
+}
@@ -0,0 +1,373 @@
+#include "PN532.h"
+
+// Frame identifiers
+static const uint8_t HOST_TO_PN532 = 0xD4;
+static const uint8_t PN532_TO_HOST = 0xD5;
+
+static const uint8_t ACK_FRAME[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+PN532::PN532(PN532Transport& transport)
+  : _transport(transport),
+    _irqPin(-1),
+    _status(PN532Status::IDLE),
+    _awaitingAck(false),
+    _command(0),
+    _expectedLength(0),
+    _timeout(0),
+    _startedAt(0),
+    _responseStart(0),
+    _responseLength(0),
+    _commandStats()
+{
+}
+
+void PN532::begin() {
+  _transport.begin();
+  _transport.wakeup();
+  
+  // The first command after wakeup may be lost, so send a throwaway one
+  getFirmwareVersion();
+}
+
+// ========== SPLIT-PHASE COMMANDS ==========
+
+void PN532::startCommand(const uint8_t* command, uint8_t length, uint8_t responseLength, uint16_t timeout) {
+  if (_status == PN532Status::BUSY) {
+    abort();
+  }
+  
+  if (length == 0 || length + PN532_FRAME_OVERHEAD > PN532_BUFFER_SIZE) {
+    _status = PN532Status::FAILED;
+    return;
+  }
+  
+  // [00][00][FF][LEN][LCS][D4][command...][DCS][00]
+  uint8_t frameLength = length + 1;
+  uint8_t sum = HOST_TO_PN532;
+  _buffer[0] = 0x00;
+  _buffer[1] = 0x00;
+  _buffer[2] = 0xFF;
+  _buffer[3] = frameLength;
+  _buffer[4] = (uint8_t)(~frameLength + 1);
+  _buffer[5] = HOST_TO_PN532;
+  for (uint8_t i = 0; i < length; i++) {
+    _buffer[6 + i] = command[i];
+    sum += command[i];
+  }
+  _buffer[6 + length] = (uint8_t)(~sum + 1);
+  _buffer[7 + length] = 0x00;
+  _commandStats = _transport.stats();
+  _transport.writeFrame(_buffer, length + PN532_FRAME_OVERHEAD);
+  
+  // Response frame carries the command code + 1 ahead of the data
+  _command = command[0];
+  _expectedLength = min(PN532_BUFFER_SIZE, PN532_FRAME_OVERHEAD + 1 + responseLength);
+  _timeout = timeout;
+  _startedAt = millis();
+  _awaitingAck = true;
+  _status = PN532Status::BUSY;
+}
+
+PN532BusStats PN532::commandBusStats() const {
+  const PN532BusStats& now = _transport.stats();
+  PN532BusStats stats;
+  stats.bytes = now.bytes - _commandStats.bytes;
+  stats.micros = now.micros - _commandStats.micros;
+  stats.transactions = now.transactions - _commandStats.transactions;
+  return stats;
+}
+
+// Does at most one status check and one frame transfer
+PN532Status PN532::poll() {
+  if (_status != PN532Status::BUSY) {
+    return _status;
+  }
+  
+  if (!isReady()) {
+    if (_timeout != 0 && millis() - _startedAt >= _timeout) {
+      abort();
+      _status = PN532Status::FAILED;
+    }
+    return _status;
+  }
+  
+  if (_awaitingAck) {
+    _awaitingAck = false;
+    if (!readAck()) {
+      _status = PN532Status::FAILED;
+    }
+    return _status;
+  }
+  
+  _status = readResponse() ? PN532Status::DONE : PN532Status::FAILED;
+  return _status;
+}
+
+// An ACK frame from the host cancels the command the PN532 is working on
+void PN532::abort() {
+  if (_status == PN532Status::BUSY) {
+    _transport.writeFrame(ACK_FRAME, sizeof(ACK_FRAME));
+  }
+  _status = PN532Status::IDLE;
+}
+
+bool PN532::command(const uint8_t* command, uint8_t length, uint8_t responseLength, uint16_t timeout) {
+  startCommand(command, length, responseLength, timeout);
+  return waitForResponse();
+}
+
+bool PN532::isReady() {
+  if (_irqPin >= 0) {
+    return digitalRead(_irqPin) == LOW;  // Active LOW while a frame is waiting
+  }
+  return _transport.isReady();
+}
+
+bool PN532::readAck() {
+  _transport.readFrame(_buffer, sizeof(ACK_FRAME));
+  return memcmp(_buffer, ACK_FRAME, sizeof(ACK_FRAME)) == 0;
+}
+
+// [00][00][FF][LEN][LCS][D5][command + 1][data...][DCS][00]
+bool PN532::readResponse() {
+  _transport.readFrame(_buffer, _expectedLength);
+  
+  // The preamble is optional, find the 00 FF start code
+  uint8_t start = 0;
+  while (start < 2 && !(_buffer[start] == 0x00 && _buffer[start + 1] == 0xFF)) {
+    start++;
+  }
+  if (_buffer[start] != 0x00 || _buffer[start + 1] != 0xFF) {
+    return false;
+  }
+  
+  uint8_t length = _buffer[start + 2];
+  uint8_t tfi = start + 4;
+  if ((uint8_t)(length + _buffer[start + 3]) != 0 || length < 2) {
+    return false;
+  }
+  
+  // A target list may run past the buffer: the ATS of an ISO14443-4 card
+  // (DESFire, phones) follows the UID. Keep what we have; the DCS is cut off
+  // then, so only the LCS has been checked.
+  bool truncated = tfi + length >= _expectedLength;
+  if (truncated && _command != PN532_COMMAND_INLISTPASSIVETARGET && _command != PN532_COMMAND_INAUTOPOLL) {
+    return false;  // More data than we asked for
+  }
+  if (_buffer[tfi] != PN532_TO_HOST || _buffer[tfi + 1] != (uint8_t)(_command + 1)) {
+    return false;  // Error frame or a reply to something else
+  }
+  
+  if (!truncated) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i <= length; i++) {
+      sum += _buffer[tfi + i];  // Data and DCS add up to zero
+    }
+    if (sum != 0) {
+      return false;
+    }
+  }
+  
+  _responseStart = tfi + 2;
+  _responseLength = truncated ? _expectedLength - _responseStart : length - 2;
+  return true;
+}
+
+// Commands started without a timeout are given PN532_BLOCKING_TIMEOUT here
+bool PN532::waitForResponse() {
+  if (_status == PN532Status::BUSY && _timeout == 0) {
+    _timeout = PN532_BLOCKING_TIMEOUT;
+  }
+  while (poll() == PN532Status::BUSY) {
+    delay(1);
+  }
+  return _status == PN532Status::DONE;
+}
+
+// ========== SETUP ==========
+
+uint32_t PN532::getFirmwareVersion() {
+  uint8_t cmd = PN532_COMMAND_GETFIRMWAREVERSION;
+  if (!command(&cmd, 1, 4) || _responseLength < 4) {
+    return 0;
+  }
+  
+  // IC, version, revision, supported protocols
+  const uint8_t* r = response();
+  return ((uint32_t)r[0] << 24) | ((uint32_t)r[1] << 16) | ((uint32_t)r[2] << 8) | r[3];
+}
+
+bool PN532::SAMConfig() {
+  // Normal mode, 1 s virtual card timeout, drive the IRQ pin
+  uint8_t cmd[4] = {PN532_COMMAND_SAMCONFIGURATION, 0x01, 0x14, 0x01};
+  return command(cmd, sizeof(cmd), 0);
+}
+
+bool PN532::setPassiveActivationRetries(uint8_t retries) {
+  // Keep the PN532 defaults for ATR_REQ and PSL_REQ retries
+  uint8_t cmd[5] = {PN532_COMMAND_RFCONFIGURATION, PN532_RFCFG_RETRIES, 0xFF, 0x01, retries};
+  return command(cmd, sizeof(cmd), 0);
+}
+
+bool PN532::setRFField(bool on) {
+  startRFField(on);
+  return waitForResponse();
+}
+
+void PN532::startRFField(bool on) {
+  uint8_t cmd[3] = {PN532_COMMAND_RFCONFIGURATION, PN532_RFCFG_FIELD, (uint8_t)(on ? 0x01 : 0x00)};
+  startCommand(cmd, sizeof(cmd), 0, 100);
+}
+
+// ========== TARGET DETECTION ==========
+
+void PN532::startListPassiveTarget(uint16_t timeout) {
+  // One target at 106 kbps type A. A longer ATS after the UID is cut off.
+  uint8_t cmd[3] = {PN532_COMMAND_INLISTPASSIVETARGET, 0x01, PN532_MIFARE_ISO14443A};
+  startCommand(cmd, sizeof(cmd), 20, timeout);
+}
+
+// [NbTg][Tg][ATQA x2][SAK][UID length][UID...]
+bool PN532::readPassiveTarget(uint8_t* uid, uint8_t* uidLength, uint16_t* atqa, uint8_t* sak) {
+  if (_status != PN532Status::DONE || _responseLength < 6 || response()[0] != 1) {
+    return false;
+  }
+  return parseTarget(response() + 1, _responseLength - 1, uid, uidLength, atqa, sak);
+}
+
+void PN532::startAutoPoll(uint8_t pollCount, uint8_t period) {
+  uint8_t cmd[4] = {PN532_COMMAND_INAUTOPOLL, pollCount, period, PN532_AUTOPOLL_TYPE_MIFARE};
+  startCommand(cmd, sizeof(cmd), 20, 0);
+}
+
+// [NbTg][Type][Length][Tg][ATQA x2][SAK][UID length][UID...]
+bool PN532::readAutoPollTarget(uint8_t* uid, uint8_t* uidLength, uint16_t* atqa, uint8_t* sak) {
+  if (_status != PN532Status::DONE || _responseLength < 8 || response()[0] == 0 ||
+      response()[1] != PN532_AUTOPOLL_TYPE_MIFARE) {
+    return false;
+  }
+  return parseTarget(response() + 3, _responseLength - 3, uid, uidLength, atqa, sak);
+}
+
+// Type A target data: [Tg][ATQA x2][SAK][UID length][UID...]
+bool PN532::parseTarget(const uint8_t* data, uint8_t length, uint8_t* uid, uint8_t* uidLength,
+                        uint16_t* atqa, uint8_t* sak) {
+  if (length < 5 || data[4] > 7 || length < 5 + data[4]) {
+    return false;
+  }
+  memcpy(uid, &data[5], data[4]);
+  *uidLength = data[4];
+  if (atqa) {
+    *atqa = ((uint16_t)data[1] << 8) | data[2];
+  }
+  if (sak) {
+    *sak = data[3];
+  }
+  return true;
+}
+
+// ========== DATA EXCHANGE ==========
+
+void PN532::startDataExchange(const uint8_t* data, uint8_t length, uint8_t replyLength, uint16_t timeout) {
+  startTargetCommand(PN532_COMMAND_INDATAEXCHANGE, data, length, replyLength, timeout);
+}
+
+// Raw exchange with the target; the PN532 adds the CRC but does not treat
+// the first byte as a Mifare command
+void PN532::startCommunicateThru(const uint8_t* data, uint8_t length, uint8_t replyLength, uint16_t timeout) {
+  startTargetCommand(PN532_COMMAND_INCOMMUNICATETHRU, data, length, replyLength, timeout);
+}
+
+void PN532::startTargetCommand(uint8_t command, const uint8_t* data, uint8_t length, uint8_t replyLength,
+                               uint16_t timeout) {
+  uint8_t cmd[PN532_BUFFER_SIZE - PN532_FRAME_OVERHEAD];
+  if (length + 2 > (int)sizeof(cmd)) {
+    _status = PN532Status::FAILED;
+    return;
+  }
+  
+  uint8_t header = 0;
+  cmd[header++] = command;
+  if (command == PN532_COMMAND_INDATAEXCHANGE) {
+    cmd[header++] = 0x01;  // Target 1; InCommunicateThru talks to the selected target
+  }
+  memcpy(&cmd[header], data, length);
+  startCommand(cmd, length + header, replyLength + 1, timeout);
+}
+
+// [status][reply...]; the low six status bits hold the error code
+bool PN532::readDataExchange(uint8_t* reply, uint8_t replyLength) {
+  if (_status != PN532Status::DONE || _responseLength < 1 + replyLength || (response()[0] & 0x3F) != 0) {
+    return false;
+  }
+  if (reply) {
+    memcpy(reply, response() + 1, replyLength);
+  }
+  return true;
+}
+
+bool PN532::dataExchange(const uint8_t* data, uint8_t length, uint8_t* reply, uint8_t replyLength) {
+  startDataExchange(data, length, replyLength);
+  return waitForResponse() && readDataExchange(reply, replyLength);
+}
+
+// ========== MIFARE ==========
+
+uint8_t PN532::buildAuthenticate(uint8_t* data, uint8_t block, uint8_t keyType, const uint8_t* key,
+                                 const uint8_t* uid, uint8_t uidLength) {
+  data[0] = keyType ? MIFARE_CMD_AUTH_B : MIFARE_CMD_AUTH_A;
+  data[1] = block;
+  memcpy(&data[2], key, 6);
+  memcpy(&data[8], uid, uidLength);
+  return 8 + uidLength;
+}
+
+void PN532::startMifareAuthenticate(uint8_t block, uint8_t keyType, const uint8_t* key,
+                                    const uint8_t* uid, uint8_t uidLength) {
+  uint8_t data[15];
+  startDataExchange(data, buildAuthenticate(data, block, keyType, key, uid, uidLength), 0);
+}
+
+void PN532::startMifareRead(uint8_t block) {
+  uint8_t data[2] = {MIFARE_CMD_READ, block};
+  startDataExchange(data, sizeof(data), 16);
+}
+
+bool PN532::mifareAuthenticate(uint8_t block, uint8_t keyType, const uint8_t* key,
+                               const uint8_t* uid, uint8_t uidLength) {
+  startMifareAuthenticate(block, keyType, key, uid, uidLength);
+  return waitForResponse() && readDataExchange(nullptr, 0);
+}
+
+bool PN532::mifareReadBlock(uint8_t block, uint8_t* data) {
+  startMifareRead(block);
+  return waitForResponse() && readDataExchange(data, 16);
+}
+
+bool PN532::mifareWriteBlock(uint8_t block, const uint8_t* data) {
+  uint8_t cmd[18];
+  cmd[0] = MIFARE_CMD_WRITE;
+  cmd[1] = block;
+  memcpy(&cmd[2], data, 16);
+  return dataExchange(cmd, sizeof(cmd));
+}
+
+bool PN532::ntagFastRead(uint8_t startPage, uint8_t endPage, uint8_t* data) {
+  uint8_t cmd[3] = {NTAG_CMD_FAST_READ, startPage, endPage};
+  uint8_t replyLength = (endPage - startPage + 1) * 4;
+  startDataExchange(cmd, sizeof(cmd), replyLength);
+  return waitForResponse() && readDataExchange(data, replyLength);
+}
+
+void PN532::startNtagGetVersion() {
+  uint8_t cmd = NTAG_CMD_GET_VERSION;
+  startCommunicateThru(&cmd, 1, NTAG_VERSION_LENGTH);
+}
+
+bool PN532::ultralightWritePage(uint8_t page, const uint8_t* data) {
+  uint8_t cmd[6];
+  cmd[0] = MIFARE_ULTRALIGHT_CMD_WRITE;
+  cmd[1] = page;
+  memcpy(&cmd[2], data, 4);
+  return dataExchange(cmd, sizeof(cmd));
+}
@@ -0,0 +1,344 @@
+#include "PN532Transport.h"
+#include <Wire.h>
+
+// ========== SOFTWARE SPI ==========
+
+PN532SoftSPI::PN532SoftSPI(uint8_t sck, uint8_t miso, uint8_t mosi, uint8_t ss)
+  : _sck(sck),
+    _miso(miso),
+    _mosi(mosi),
+    _ss(ss)
+{
+}
+
+void PN532SoftSPI::begin() {
+  pinMode(_ss, OUTPUT);
+  pinMode(_sck, OUTPUT);
+  pinMode(_mosi, OUTPUT);
+  pinMode(_miso, INPUT);
+  digitalWrite(_ss, HIGH);
+  digitalWrite(_sck, LOW);
+}
+
+void PN532SoftSPI::wakeup() {
+  // Holding SS low wakes the PN532 from power down
+  digitalWrite(_ss, LOW);
+  delay(2);
+  digitalWrite(_ss, HIGH);
+}
+
+bool PN532SoftSPI::isReady() {
+  unsigned long start = micros();
+  digitalWrite(_ss, LOW);
+  transfer(PN532_SPI_STATUS_READ);
+  uint8_t status = transfer(0x00);
+  digitalWrite(_ss, HIGH);
+  account(2, start);
+  return (status & PN532_STATUS_READY) != 0;
+}
+
+void PN532SoftSPI::writeFrame(const uint8_t* frame, uint8_t length) {
+  unsigned long start = micros();
+  digitalWrite(_ss, LOW);
+  transfer(PN532_SPI_DATA_WRITE);
+  for (uint8_t i = 0; i < length; i++) {
+    transfer(frame[i]);
+  }
+  digitalWrite(_ss, HIGH);
+  account(length + 1, start);
+}
+
+void PN532SoftSPI::readFrame(uint8_t* buffer, uint8_t length) {
+  unsigned long start = micros();
+  digitalWrite(_ss, LOW);
+  transfer(PN532_SPI_DATA_READ);
+  for (uint8_t i = 0; i < length; i++) {
+    buffer[i] = transfer(0x00);
+  }
+  digitalWrite(_ss, HIGH);
+  account(length + 1, start);
+}
+
+// The PN532 samples MOSI on the rising edge and shifts MISO on the falling one
+uint8_t PN532SoftSPI::transfer(uint8_t out) {
+  uint8_t in = 0;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    digitalWrite(_mosi, (out >> bit) & 0x01);
+    digitalWrite(_sck, HIGH);
+    if (digitalRead(_miso)) {
+      in |= (1 << bit);
+    }
+    digitalWrite(_sck, LOW);
+  }
+  return in;
+}
+
+// ========== HARDWARE SPI ==========
+
+PN532HardSPI::PN532HardSPI(uint8_t ss, uint32_t clock)
+  : _ss(ss),
+    _settings(min(clock, PN532_SPI_MAX_CLOCK), LSBFIRST, SPI_MODE0)
+{
+}
+
+void PN532HardSPI::begin() {
+  pinMode(_ss, OUTPUT);
+  digitalWrite(_ss, HIGH);
+  SPI.begin();
+}
+
+void PN532HardSPI::wakeup() {
+  // Holding SS low wakes the PN532 from power down
+  digitalWrite(_ss, LOW);
+  delay(2);
+  digitalWrite(_ss, HIGH);
+}
+
+bool PN532HardSPI::isReady() {
+  unsigned long start = micros();
+  select();
+  SPI.transfer(PN532_SPI_STATUS_READ);
+  uint8_t status = SPI.transfer(0x00);
+  deselect();
+  account(2, start);
+  return (status & PN532_STATUS_READY) != 0;
+}
+
+void PN532HardSPI::writeFrame(const uint8_t* frame, uint8_t length) {
+  unsigned long start = micros();
+  select();
+  SPI.transfer(PN532_SPI_DATA_WRITE);
+  for (uint8_t i = 0; i < length; i++) {
+    SPI.transfer(frame[i]);
+  }
+  deselect();
+  account(length + 1, start);
+}
+
+void PN532HardSPI::readFrame(uint8_t* buffer, uint8_t length) {
+  unsigned long start = micros();
+  select();
+  SPI.transfer(PN532_SPI_DATA_READ);
+  for (uint8_t i = 0; i < length; i++) {
+    buffer[i] = SPI.transfer(0x00);
+  }
+  deselect();
+  account(length + 1, start);
+}
+
+// Settings go in per transaction, other SPI devices may use other modes
+void PN532HardSPI::select() {
+  SPI.beginTransaction(_settings);
+  digitalWrite(_ss, LOW);
+}
+
+void PN532HardSPI::deselect() {
+  digitalWrite(_ss, HIGH);
+  SPI.endTransaction();
+}
+
+// ========== I2C ==========
+
+PN532I2C::PN532I2C(uint8_t resetPin, uint32_t clock)
+  : _resetPin(resetPin),
+    _clock(min(clock, PN532_I2C_MAX_CLOCK))
+{
+}
+
+void PN532I2C::begin() {
+  pinMode(_resetPin, OUTPUT);
+  digitalWrite(_resetPin, HIGH);
+  Wire.begin();
+  Wire.setClock(_clock);
+}
+
+void PN532I2C::wakeup() {
+  // I2C has no wakeup sequence of its own, so reset the chip instead
+  digitalWrite(_resetPin, LOW);
+  delay(400);
+  digitalWrite(_resetPin, HIGH);
+  delay(10);
+}
+
+bool PN532I2C::isReady() {
+  unsigned long start = micros();
+  uint8_t received = Wire.requestFrom((uint8_t)PN532_I2C_ADDRESS, (uint8_t)1);
+  account(1, start);
+  if (received != 1) {
+    return false;
+  }
+  return (Wire.read() & PN532_STATUS_READY) != 0;
+}
+
+void PN532I2C::writeFrame(const uint8_t* frame, uint8_t length) {
+  unsigned long start = micros();
+  Wire.beginTransmission(PN532_I2C_ADDRESS);
+  Wire.write(frame, length);
+  Wire.endTransmission();
+  account(length, start);
+}
+
+void PN532I2C::readFrame(uint8_t* buffer, uint8_t length) {
+  unsigned long start = micros();
+  Wire.requestFrom((uint8_t)PN532_I2C_ADDRESS, (uint8_t)(length + 1));
+  account(length + 1, start);
+  Wire.read();  // Status byte
+  for (uint8_t i = 0; i < length; i++) {
+    buffer[i] = Wire.available() ? Wire.read() : 0x00;
+  }
+}
+
+// ========== HSU ==========
+
+PN532HSU::PN532HSU(HardwareSerial& serial, uint32_t baud, uint8_t wakeupLength)
+  : _serial(serial),
+    _requestedBaud(baud),
+    _baud(PN532_HSU_DEFAULT_BAUD),
+    _wakeupLength(wakeupLength)
+{
+  resetFrame();
+}
+
+void PN532HSU::begin() {
+  _baud = PN532_HSU_DEFAULT_BAUD;
+  _serial.begin(_baud);
+}
+
+void PN532HSU::wakeup() {
+  // 0x55 0x55 and a run of zeros wake the PN532 from power down
+  unsigned long start = micros();
+  _serial.write((uint8_t)0x55);
+  _serial.write((uint8_t)0x55);
+  for (uint8_t i = 2; i < _wakeupLength; i++) {
+    _serial.write((uint8_t)0x00);
+  }
+  _serial.flush();
+  account(_wakeupLength, start);
+  delay(2);
+  
+  if (_requestedBaud != _baud && !changeBaud()) {
+    _requestedBaud = _baud;  // Stay at 115200 rather than lose the link
+  }
+}
+
+bool PN532HSU::isReady() {
+  if (_frameLength != 0 && _received == _frameLength) {
+    return true;
+  }
+  
+  unsigned long start = micros();
+  uint8_t drained = 0;
+  while (_serial.available() && (_frameLength == 0 || _received < _frameLength)) {
+    uint8_t in = _serial.read();
+    drained++;
+  
+    if (_received == 1) {
+      if (in == 0x00) {
+        _frame[_received++] = in;  // Start code, first byte
+      }
+    } else if (_received == 2) {
+      if (in == 0xFF) {
+        _frame[_received++] = in;
+      } else if (in != 0x00) {
+        resetFrame();  // More preamble zeros are fine, anything else is noise
+      }
+    } else if (_received == 3) {
+      _frame[_received++] = in;  // LEN
+    } else if (_received == 4) {
+      _frame[_received++] = in;  // LCS
+      uint8_t length = _frame[3];
+      if (length == 0 && in == 0xFF) {
+        _frameLength = 5;  // ACK, no data
+      } else if ((uint8_t)(length + in) == 0) {
+        _frameLength = length + 6;  // Through DCS; the postamble is left behind
+      } else {
+        resetFrame();  // NACK or a bad length
+      }
+    } else {
+      // Bytes past the buffer are counted, not kept (a long ATS)
+      if (_received < PN532_HSU_FRAME_SIZE) {
+        _frame[_received] = in;
+      }
+      _received++;
+    }
+  }
+  if (drained > 0) {
+    account(drained, start);
+  }
+  return _frameLength != 0 && _received == _frameLength;
+}
+
+void PN532HSU::writeFrame(const uint8_t* frame, uint8_t length) {
+  // Whatever is still on its way in answers an earlier command
+  while (_serial.available()) {
+    _serial.read();
+  }
+  resetFrame();
+  
+  unsigned long start = micros();
+  _serial.write(frame, length);
+  account(length, start);
+}
+
+void PN532HSU::readFrame(uint8_t* buffer, uint8_t length) {
+  for (uint8_t i = 0; i < length; i++) {
+    buffer[i] = i < _received && i < PN532_HSU_FRAME_SIZE ? _frame[i] : 0x00;
+  }
+  resetFrame();
+}
+
+void PN532HSU::resetFrame() {
+  _frame[0] = 0x00;
+  _received = 1;
+  _frameLength = 0;
+}
+
+// SetSerialBaudRate at 115200; the PN532 moves over once it sees our ACK
+// to its response, so we only follow it after a good response
+bool PN532HSU::changeBaud() {
+  static const uint32_t RATES[] = {
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1288000
+  };
+  uint8_t code = 0;
+  while (code < sizeof(RATES) / sizeof(RATES[0]) && RATES[code] != _requestedBaud) {
+    code++;
+  }
+  if (code == sizeof(RATES) / sizeof(RATES[0])) {
+    return false;
+  }
+  
+  // [00][00][FF][LEN][LCS][D4][10][rate][DCS][00]
+  const uint8_t sum = 0xD4 + PN532_COMMAND_SETSERIALBAUDRATE + code;
+  const uint8_t command[] = {
+    0x00, 0x00, 0xFF, 0x03, 0xFD, 0xD4, PN532_COMMAND_SETSERIALBAUDRATE, code, (uint8_t)(~sum + 1), 0x00
+  };
+  static const uint8_t ACK[] = { 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00 };
+  
+  // The first command after wakeup may be lost, so allow a second try
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    writeFrame(command, sizeof(command));
+    if (waitFrame(0, 10) && waitFrame(PN532_COMMAND_SETSERIALBAUDRATE + 1, 50)) {
+      writeFrame(ACK, sizeof(ACK));
+      _serial.flush();
+      _baud = _requestedBaud;
+      _serial.begin(_baud);
+      delay(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Wait for an ACK (responseCode 0) or the response with that code
+bool PN532HSU::waitFrame(uint8_t responseCode, uint16_t timeout) {
+  unsigned long start = millis();
+  while (!isReady()) {
+    if (millis() - start > timeout) {
+      return false;
+    }
+    delay(1);
+  }
+  bool match = responseCode == 0 ? _frameLength == 5 : _frameLength > 7 && _frame[6] == responseCode;
+  resetFrame();
+  return match;
+}
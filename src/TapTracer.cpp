@@ -0,0 +1,113 @@
+#include "TapTracer.h"
+
+#ifdef TAP_TRACING
+
+TapTracer TapTrace;
+
+static const char POINT_IRQ[] PROGMEM = "irq";
+static const char POINT_POLL[] PROGMEM = "poll";
+static const char POINT_UID[] PROGMEM = "uid";
+static const char POINT_SECTOR[] PROGMEM = "sector";
+static const char POINT_DECISION[] PROGMEM = "decision";
+static const char POINT_RELAY[] PROGMEM = "relay";
+
+static const char* const POINT_NAMES[] = {
+  POINT_IRQ, POINT_POLL, POINT_UID, POINT_SECTOR, POINT_DECISION, POINT_RELAY
+};
+
+TapTracer::TapTracer() {
+  reset();
+}
+
+void TapTracer::reset() {
+  _head = 0;
+  _tapStart = 0;
+  _tapOpen = false;
+  _latencyHead = 0;
+  _latencyCount = 0;
+}
+
+// ========== TRACE POINTS ==========
+
+void TapTracer::startTap(TracePoint point, unsigned long at) {
+  _tapStart = _head;
+  _tapOpen = true;
+  add(point, at);
+}
+
+void TapTracer::mark(TracePoint point) {
+  if (_tapOpen) {
+    add(point, micros());
+  }
+}
+
+void TapTracer::add(TracePoint point, unsigned long at) {
+  _events[_head].at = at;
+  _events[_head].point = point;
+  _head = (_head + 1) % TAP_TRACE_EVENTS;
+}
+
+void TapTracer::endTap(bool unlocked) {
+  if (!_tapOpen) {
+    return;
+  }
+  _tapOpen = false;
+  
+  if (unlocked) {
+    uint8_t last = (_head + TAP_TRACE_EVENTS - 1) % TAP_TRACE_EVENTS;
+    _latencies[_latencyHead] = _events[last].at - _events[_tapStart].at;
+    _latencyHead = (_latencyHead + 1) % TAP_TRACE_HISTORY;
+    if (_latencyCount < TAP_TRACE_HISTORY) {
+      _latencyCount++;
+    }
+  }
+  printTap();
+}
+
+// ========== REPORTS ==========
+
+// "Tap: irq 0 uid 6120 sector 9870 decision 9890 relay 9900 us"
+void TapTracer::printTap() {
+  unsigned long start = _events[_tapStart].at;
+  Serial.print(F("Tap:"));
+  for (uint8_t i = _tapStart; i != _head; i = (i + 1) % TAP_TRACE_EVENTS) {
+    Serial.print(F(" "));
+    Serial.print((__FlashStringHelper*)POINT_NAMES[(uint8_t)_events[i].point]);
+    Serial.print(F(" "));
+    Serial.print(_events[i].at - start);
+  }
+  Serial.println(F(" us"));
+}
+
+void TapTracer::printSummary() {
+  Serial.print(F("Tap-to-unlock, last "));
+  Serial.print(_latencyCount);
+  Serial.print(F(" taps:"));
+  if (_latencyCount == 0) {
+    Serial.println();
+    return;
+  }
+  
+  // Insertion sort of a copy; the history is small
+  uint32_t sorted[TAP_TRACE_HISTORY];
+  for (uint8_t i = 0; i < _latencyCount; i++) {
+    uint32_t value = _latencies[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  
+  // Nearest-rank percentiles
+  Serial.print(F(" p50 "));
+  Serial.print(sorted[(_latencyCount * 50 + 99) / 100 - 1]);
+  Serial.print(F(" p95 "));
+  Serial.print(sorted[(_latencyCount * 95 + 99) / 100 - 1]);
+  Serial.print(F(" max "));
+  Serial.print(sorted[_latencyCount - 1]);
+  Serial.println(F(" us"));
+}
+
+#endif // TAP_TRACING
@@ -4,6 +4,9 @@
 #include "AccessControlSystem.h"
 
 NFCReader nfcReader(NFC_COMM_SPI, NFC_READ_IRQ);
+#ifdef NFC_EXIT_READER
+NFCReader exitReader(NFC_COMM_SPI, NFC_READ_IRQ);
+#endif
 AccessControlSystem accessControl(nfcReader);
 
 void setup() {
@@ -18,6 +21,15 @@ void setup() {
   Serial.println(F("\n=== Access Control System ==="));
   Serial.println(F("Initializing...\n"));
   
+  nfcReader.setSPIClock(NFC_SPI_CLOCK);
+  nfcReader.setI2CClock(NFC_I2C_CLOCK);
+  nfcReader.setHSUBaud(NFC_HSU_BAUD);
+#ifdef NFC_EXIT_READER
+  exitReader.setSPIPins(NFC_SCK, NFC_MISO, NFC_MOSI, NFC_EXIT_SS);
+  exitReader.setSPIClock(NFC_SPI_CLOCK);
+  exitReader.setIRQPin(NFC_EXIT_IRQ);
+  accessControl.addReader(exitReader);
+#endif
   if (!accessControl.begin()) {
     Serial.println(F("FATAL: System initialization failed!"));
     // Non-blocking error state - continue running but display error
@@ -32,4 +44,36 @@ void setup() {
 
 void loop() {
   accessControl.update();
+  
+#if defined(LOOP_PROFILING) || defined(TAP_TRACING)
+  // 'p' prints the loop timing report, 'n' the poll, RF field and bus
+  // telemetry, 't' the tap latency summary, 'r' clears them
+  if (Serial.available()) {
+    char command = Serial.read();
+#ifdef LOOP_PROFILING
+    if (command == 'p') LoopProfile.print();
+    if (command == 'r') LoopProfile.reset();
+    if (command == 'n') {
+      nfcReader.printPollStats();
+      nfcReader.printBusStats();
+#ifdef NFC_EXIT_READER
+      exitReader.printPollStats();
+      exitReader.printBusStats();
+#endif
+    }
+    if (command == 'r') {
+      nfcReader.resetFieldStats();
+      nfcReader.resetBusStats();
+#ifdef NFC_EXIT_READER
+      exitReader.resetFieldStats();
+      exitReader.resetBusStats();
+#endif
+    }
+#endif
+#ifdef TAP_TRACING
+    if (command == 't') TapTrace.printSummary();
+    if (command == 'r') TapTrace.reset();
+#endif
+  }
+#endif
 }
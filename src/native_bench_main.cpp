@@ -0,0 +1,405 @@
+/*
+ * Host benchmark for AccessControlSystem::update()
+ *
+ * Built by the [env:native] environment against lib/NativeHAL, which
+ * models the Nano's timing (pins, EEPROM, LCD, PN532 driver) on a
+ * virtual clock. Reports:
+ * - idle loop cost per update()
+ * - tap-to-relay latency for registered cards
+ * - tap-to-deny latency for unknown cards
+ * - Bloom filter and sector cache hit counts
+ * - per-phase update() timing while tapping (LoopProfiler)
+ * - traced tap-to-unlock percentiles and the last tap's trace (TapTracer)
+ * - LCD traffic while scrolling the menu
+ * - poll interval and duty cycle, busy and idle (--poll only)
+ * - PN532 bus bytes and time while tapping
+ * - RF field on time and detection latency, firmware estimate against
+ *   the emulated PN532
+ * Virtual times approximate the target; host times only measure the
+ * CPU cost of the loop logic on this machine.
+ *
+ * Usage: .pio/build/native/program [-v] [--poll] [--irqready] [--i2c] [--slowi2c] [--softspi]
+ *                                   [--hsu [baud]] [--dutycycle] [--autopoll N] [--exit]
+ *   -v           echo the firmware's Serial output
+ *   --poll       use NFCReadMode::POLLING instead of IRQ
+ *   --irqready   wait for responses on the IRQ pin when polling
+ *   --i2c        talk to the PN532 over I2C at NFC_I2C_CLOCK instead of SPI
+ *   --slowi2c    I2C at the Wire default of 100 kHz
+ *   --softspi    bit-bang SPI instead of the hardware peripheral at NFC_SPI_CLOCK
+ *   --hsu        talk to the PN532 over HSU on Serial1 (a pseudo-terminal), at
+ *                NFC_HSU_BAUD or the given rate
+ *   --dutycycle  switch the RF field off between polls (--poll)
+ *   --autopoll   arm InAutoPoll every N x 150 ms instead of InListPassiveTarget (IRQ)
+ *   --exit       add an exit reader on the same SPI bus (NFC_EXIT_SS, NFC_EXIT_IRQ)
+ *                and time it while the entry reader is busy
+ */
+
+#ifdef BUILD_NATIVE_BENCH
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <NativePN532.h>
+#include <LiquidCrystal.h>
+#include "Config.h"
+#include "NFCReader.h"
+#include "AccessControlSystem.h"
+
+// Loop overhead not covered by the cost model (call, branches, Serial checks)
+static const uint32_t LOOP_OVERHEAD_US = 10;
+static const uint16_t IDLE_ITERATIONS = 2000;
+static const uint8_t TAPS_PER_CASE = 20;
+static const uint32_t TAP_TIMEOUT_US = 1000000UL;
+static const uint32_t CARD_DWELL_US = 150000UL;   // Card stays in the field after the reaction
+static const uint32_t SETTLE_US = 4000000UL;
+static const uint8_t MENU_SCROLLS = 20;
+static const uint32_t BUTTON_HOLD_US = 100000UL;
+static const uint32_t POLL_IDLE_US = 60000000UL;
+static const uint32_t LONG_PRESS_US = 1200000UL;
+
+struct Stats {
+  uint64_t minValue;
+  uint64_t maxValue;
+  uint64_t sum;
+  uint32_t count;
+
+  Stats() : minValue(UINT64_MAX), maxValue(0), sum(0), count(0) {}
+
+  void add(uint64_t value) {
+    if (value < minValue) minValue = value;
+    if (value > maxValue) maxValue = value;
+    sum += value;
+    count++;
+  }
+
+  void print(const char* label, const char* unit, double scale) const {
+    if (count == 0) {
+      printf("  %-28s no samples\n", label);
+      return;
+    }
+    printf("  %-28s min %9.1f  mean %9.1f  max %9.1f %s  (n=%u)\n", label,
+           minValue / scale, (double)sum / count / scale, maxValue / scale, unit, count);
+  }
+};
+
+static Stats gLoopVirtual;
+static Stats gLoopHost;
+
+static void uidForCard(uint16_t n, uint8_t* uid) {
+  uid[0] = 0xB0;
+  uid[1] = (uint8_t)(n >> 8);
+  uid[2] = (uint8_t)n;
+  uid[3] = (uint8_t)(0x5A ^ n);
+}
+
+static NFCCardInfo cardInfoFor(uint16_t n) {
+  NFCCardInfo info;
+  memset(&info, 0, sizeof(info));
+  info.detected = true;
+  uidForCard(n, info.uid);
+  info.uidLength = 4;
+  info.cardType = NFCCardType::MIFARE_CLASSIC_1K;
+  return info;
+}
+
+static void step(AccessControlSystem& system) {
+  uint64_t virtualStart = NativeHAL::nowMicros();
+  uint64_t hostStart = NativeHAL::hostNanos();
+  system.update();
+  gLoopHost.add(NativeHAL::hostNanos() - hostStart);
+  NativeHAL::advanceMicros(LOOP_OVERHEAD_US);
+  gLoopVirtual.add(NativeHAL::nowMicros() - virtualStart);
+}
+
+static void runFor(AccessControlSystem& system, uint32_t us) {
+  uint64_t end = NativeHAL::nowMicros() + us;
+  while (NativeHAL::nowMicros() < end) {
+    step(system);
+  }
+}
+
+static bool relayActive() {
+  return NativeHAL::outputLevel(RELAY_PIN) == (RELAY_ACTIVE_HIGH ? HIGH : LOW);
+}
+
+static bool showingDenied() {
+  LiquidCrystal* lcd = NativeHAL::lcd();
+  return lcd && lcd->line(0).find("Denied") != std::string::npos;
+}
+
+// Present a card, run the loop until the system reacts, leave it in the
+// field a moment as a hand would, then take it away and let the relay,
+// the message and the reader's card timeout expire.
+static void tap(AccessControlSystem& system, uint16_t card, bool expectGrant, Stats& latency) {
+  uint8_t uid[4];
+  uidForCard(card, uid);
+
+  uint64_t start = NativeHAL::nowMicros();
+  NativePN532::module().present(NativeCard::classic1K(uid));
+
+  while (NativeHAL::nowMicros() - start < TAP_TIMEOUT_US) {
+    step(system);
+    if (expectGrant && relayActive()) {
+      latency.add(NativeHAL::lastOutputChangeMicros(RELAY_PIN) - start);
+      break;
+    }
+    if (!expectGrant && showingDenied()) {
+      latency.add(NativeHAL::nowMicros() - start);
+      break;
+    }
+  }
+
+  runFor(system, CARD_DWELL_US);
+  NativePN532::module().remove();
+  runFor(system, SETTLE_US);
+}
+
+// A registered card on the exit reader, optionally while the entry
+// reader works through an unknown Classic card's sector read
+static void tapExit(AccessControlSystem& system, NativePN532& exitModule, uint16_t card,
+                    bool entryBusy, Stats& latency) {
+  uint8_t uid[4];
+  uidForCard(card, uid);
+  uint8_t stranger[4];
+  uidForCard(3000 + card, stranger);
+
+  uint64_t start = NativeHAL::nowMicros();
+  if (entryBusy) {
+    NativePN532::module().present(NativeCard::classic1K(stranger));
+  }
+  exitModule.present(NativeCard::classic1K(uid));
+
+  while (NativeHAL::nowMicros() - start < TAP_TIMEOUT_US) {
+    step(system);
+    if (relayActive()) {
+      latency.add(NativeHAL::lastOutputChangeMicros(RELAY_PIN) - start);
+      break;
+    }
+  }
+
+  exitModule.remove();
+  NativePN532::module().remove();
+  runFor(system, SETTLE_US);
+}
+
+// Hold a button long enough to pass the debounce, then release it
+static void press(AccessControlSystem& system, uint8_t pin, uint32_t holdUs) {
+  NativeHAL::setInput(pin, LOW);
+  runFor(system, holdUs);
+  NativeHAL::setInput(pin, HIGH);
+  runFor(system, BUTTON_HOLD_US);
+}
+
+static double fieldSecondsPerHour(uint64_t onMicros, uint64_t elapsedMicros) {
+  return elapsedMicros ? onMicros * 3600.0 / elapsedMicros : 0.0;
+}
+
+int main(int argc, char** argv) {
+  bool polling = false;
+  bool i2c = false;
+  bool irqReady = false;
+  bool slowI2C = false;
+  bool softSPI = false;
+  uint32_t hsuBaud = 0;
+  bool dutyCycling = false;
+  uint8_t autoPollPeriod = 0;
+  bool withExit = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) NativeHAL::setSerialEcho(true);
+    if (strcmp(argv[i], "--poll") == 0) polling = true;
+    if (strcmp(argv[i], "--i2c") == 0) i2c = true;
+    if (strcmp(argv[i], "--irqready") == 0) irqReady = true;
+    if (strcmp(argv[i], "--slowi2c") == 0) i2c = slowI2C = true;
+    if (strcmp(argv[i], "--softspi") == 0) softSPI = true;
+    if (strcmp(argv[i], "--hsu") == 0) {
+      hsuBaud = (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) ? strtoul(argv[++i], nullptr, 10) : NFC_HSU_BAUD;
+    }
+    if (strcmp(argv[i], "--dutycycle") == 0) dutyCycling = true;
+    if (strcmp(argv[i], "--autopoll") == 0 && i + 1 < argc) autoPollPeriod = (uint8_t)atoi(argv[++i]);
+    if (strcmp(argv[i], "--exit") == 0) withExit = true;
+  }
+
+  NativeHAL::reset();
+  NativeHAL::eepromFill(0xFF);
+  NativePN532::module().setIrqPin(NFC_IRQ);
+  if (hsuBaud) {
+    NativePN532::module().attachHSU();
+  } else {
+    NativePN532::module().attachSPI(NFC_SCK, NFC_MISO, NFC_MOSI, NFC_SS);
+    NativePN532::module().attachI2C();
+  }
+  withExit = withExit && !hsuBaud && !i2c;
+  NativePN532 exitModule;
+  if (withExit) {
+    exitModule.setIrqPin(NFC_EXIT_IRQ);
+    exitModule.attachSPI(NFC_SCK, NFC_MISO, NFC_MOSI, NFC_EXIT_SS);
+  }
+
+  NFCReader reader(hsuBaud ? NFC_COMM_HSU : i2c ? NFC_COMM_I2C : NFC_COMM_SPI,
+                   polling ? NFC_READ_POLLING : NFC_READ_IRQ);
+  reader.setSPIClock(softSPI ? 0 : NFC_SPI_CLOCK);
+  reader.setI2CClock(slowI2C ? 100000 : NFC_I2C_CLOCK);
+  if (hsuBaud) reader.setHSUBaud(hsuBaud);
+  reader.setIRQReady(irqReady);
+  reader.setFieldDutyCycling(dutyCycling);
+  reader.setAutoPollPeriod(autoPollPeriod);
+  AccessControlSystem system(reader);
+  NFCReader exitReader(NFC_COMM_SPI, polling ? NFC_READ_POLLING : NFC_READ_IRQ);
+  if (withExit) {
+    exitReader.setSPIPins(NFC_SCK, NFC_MISO, NFC_MOSI, NFC_EXIT_SS);
+    exitReader.setSPIClock(softSPI ? 0 : NFC_SPI_CLOCK);
+    exitReader.setIRQPin(NFC_EXIT_IRQ);
+    exitReader.setIRQReady(irqReady);
+    system.addReader(exitReader);
+  }
+  if (!system.begin()) {
+    printf("begin() failed\n");
+    return 1;
+  }
+
+  system.clearAllCards();
+  for (uint16_t i = 0; i < MAX_STORED_CARDS; i++) {
+    system.addCard(cardInfoFor(i));
+  }
+  printf("Native bench: %s %s mode, %u cards enrolled%s\n",
+         hsuBaud ? "HSU" : slowI2C ? "100 kHz I2C" : i2c ? "I2C" : softSPI ? "soft SPI" : "SPI",
+         polling ? "POLLING" : "IRQ", system.getStoredCardCount(), withExit ? ", exit reader" : "");
+  if (hsuBaud) {
+    printf("HSU on %s at %lu baud\n", NativeHAL::uartPtyName(), (unsigned long)NativePN532::module().hsuBaud());
+  }
+
+  runFor(system, SETTLE_US);
+
+  gLoopVirtual = Stats();
+  gLoopHost = Stats();
+  for (uint16_t i = 0; i < IDLE_ITERATIONS; i++) {
+    step(system);
+  }
+  printf("\nIdle loop\n");
+  gLoopVirtual.print("update() virtual", "us", 1.0);
+  gLoopHost.print("update() host", "ns", 1.0);
+
+  Stats firstSlot;
+  Stats lastSlot;
+  Stats unknown;
+  gLoopVirtual = Stats();
+  gLoopHost = Stats();
+#ifdef LOOP_PROFILING
+  LoopProfile.reset();
+#endif
+#ifdef TAP_TRACING
+  TapTrace.reset();
+#endif
+  reader.resetFieldStats();
+  reader.resetBusStats();
+  uint64_t fieldBefore = NativePN532::module().fieldOnMicros();
+  uint64_t tapsStart = NativeHAL::nowMicros();
+  NativeHAL::clearSerialOutput();
+  for (uint8_t i = 0; i < TAPS_PER_CASE; i++) {
+    tap(system, 0, true, firstSlot);
+    tap(system, MAX_STORED_CARDS - 1, true, lastSlot);
+    tap(system, 1000 + i, false, unknown);
+  }
+  std::string tapLog = NativeHAL::serialOutput();
+
+  printf("\nTap latency (virtual)\n");
+  firstSlot.print("grant, first slot", "ms", 1000.0);
+  lastSlot.print("grant, last slot", "ms", 1000.0);
+  unknown.print("deny, unknown card", "ms", 1000.0);
+
+  printf("\nLoop cost while tapping\n");
+  gLoopVirtual.print("update() virtual", "us", 1.0);
+  gLoopHost.print("update() host", "ns", 1.0);
+
+#ifdef LOOP_PROFILING
+  printf("\n");
+  NativeHAL::clearSerialOutput();
+  LoopProfile.print();
+  printf("%s", NativeHAL::serialOutput().c_str());
+#endif
+#ifdef TAP_TRACING
+  // Summary plus the trace line of the last grant
+  NativeHAL::clearSerialOutput();
+  TapTrace.printSummary();
+  printf("\n%s", NativeHAL::serialOutput().c_str());
+  size_t lastGrant = tapLog.rfind(" relay ");
+  if (lastGrant != std::string::npos) {
+    size_t start = tapLog.rfind("Tap:", lastGrant);
+    printf("Last grant: %s\n", tapLog.substr(start, tapLog.find('\n', start) - start).c_str());
+  }
+#endif
+
+  if (polling) {
+    printf("\nPolling after taps: %u ms interval, %u%% duty\n",
+           reader.getPollInterval(), reader.getPollDutyCycle());
+  }
+  printf("RF field while tapping: %u s/h (emulator %.0f s/h), detection ~%.1f ms\n",
+         reader.getFieldOnSecondsPerHour(),
+         fieldSecondsPerHour(NativePN532::module().fieldOnMicros() - fieldBefore, NativeHAL::nowMicros() - tapsStart),
+         reader.getAverageDetectionLatency() / 1000.0);
+
+  printf("\nPN532 commands: %u  auth: %u  EEPROM writes: %u\n",
+         NativePN532::module().commands, NativePN532::module().authentications,
+         NativeHAL::eepromTotalWrites());
+  PN532BusStats bus = reader.getBusStats();
+  printf("PN532 bus: %lu bytes, %.1f ms in %lu transactions (%.2f ms per tap)\n",
+         (unsigned long)bus.bytes, bus.micros / 1000.0, (unsigned long)bus.transactions,
+         bus.micros / 1000.0 / (3 * TAPS_PER_CASE));
+  printf("Sector cache: %u hits, %u misses\n",
+         reader.getSectorCacheHits(), reader.getSectorCacheMisses());
+  const CardFilterStats& filter = system.getFilterStats();
+  printf("Bloom filter: %lu lookups, %lu rejected, %lu false positives\n",
+         (unsigned long)filter.lookups, (unsigned long)filter.rejects,
+         (unsigned long)filter.falsePositives);
+
+  if (withExit) {
+    Stats exitAlone;
+    Stats exitBusy;
+    for (uint8_t i = 0; i < TAPS_PER_CASE; i++) {
+      tapExit(system, exitModule, 1, false, exitAlone);
+      tapExit(system, exitModule, 1, true, exitBusy);
+    }
+    printf("\nExit reader grant (virtual)\n");
+    exitAlone.print("entry idle", "ms", 1000.0);
+    exitBusy.print("entry reading a sector", "ms", 1000.0);
+    printf("  Exit PN532 commands: %u  auth: %u\n", exitModule.commands, exitModule.authentications);
+  }
+
+  // Menu scrolling redraws two lines per press
+  LiquidCrystal* lcd = NativeHAL::lcd();
+  press(system, BTN_SELECT, LONG_PRESS_US);
+  lcd->resetCounters();
+  gLoopVirtual = Stats();
+  uint32_t pushedBefore = system.getDisplay().bytesPushed();
+  for (uint8_t i = 0; i < MENU_SCROLLS; i++) {
+    press(system, BTN_DOWN, BUTTON_HOLD_US);
+  }
+  printf("\nMenu scroll (%u presses)\n", MENU_SCROLLS);
+  gLoopVirtual.print("update() virtual", "us", 1.0);
+  printf("  LCD: %u bytes (%u commands, %u clears), %.1f ms bus time\n",
+         lcd->dataBytes() + lcd->commandCount(), lcd->commandCount(), lcd->clearCount(),
+         lcd->busMicros() / 1000.0);
+  printf("  Firmware counter: %lu bytes pushed, %u bytes/s last second\n",
+         (unsigned long)(system.getDisplay().bytesPushed() - pushedBefore),
+         system.getDisplay().bytesPerSecond());
+
+  // Empty lobby: the poll scheduler backs off once NFC_POLL_IDLE_AFTER has passed
+  runFor(system, POLL_IDLE_US);
+  uint32_t commands = NativePN532::module().commands;
+  reader.resetFieldStats();
+  fieldBefore = NativePN532::module().fieldOnMicros();
+  runFor(system, NFC_POLL_WINDOW * 1000);
+  if (polling) {
+    printf("\nPolling idle: %u ms interval, %u%% duty, %u PN532 commands in %lu s\n",
+           reader.getPollInterval(), reader.getPollDutyCycle(),
+           NativePN532::module().commands - commands, NFC_POLL_WINDOW / 1000);
+  } else {
+    printf("\n");
+  }
+  printf("RF field idle: %u s/h (emulator %.0f s/h), detection ~%.1f ms\n",
+         reader.getFieldOnSecondsPerHour(),
+         fieldSecondsPerHour(NativePN532::module().fieldOnMicros() - fieldBefore, NFC_POLL_WINDOW * 1000),
+         reader.getAverageDetectionLatency() / 1000.0);
+  return 0;
+}
+
+#endif // BUILD_NATIVE_BENCH
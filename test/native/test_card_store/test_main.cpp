@@ -0,0 +1,435 @@
+// CardStore on the host EEPROM: appends and wrap-around, tombstones,
+// compaction, journal recovery after a torn write and older layouts.
+//   pio test -e native_test -f native/test_card_store
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <unity.h>
+#include "CardStore.h"
+
+static void uidFor(uint16_t n, uint8_t length, uint8_t* uid) {
+  for (uint8_t i = 0; i < length; i++) {
+    uid[i] = (uint8_t)(n >> (8 * (i % 2))) ^ (uint8_t)(i * 37);
+  }
+}
+
+static bool containsCard(CardStore& store, uint16_t n, uint8_t length) {
+  uint8_t uid[MAX_UID_LENGTH];
+  uidFor(n, length, uid);
+  return store.contains(uid, length);
+}
+
+static bool addCard(CardStore& store, uint16_t n, uint8_t length) {
+  uint8_t uid[MAX_UID_LENGTH];
+  uidFor(n, length, uid);
+  return store.add(uid, length);
+}
+
+static bool removeCard(CardStore& store, uint16_t n, uint8_t length) {
+  uint8_t uid[MAX_UID_LENGTH];
+  uidFor(n, length, uid);
+  return store.remove(uid, length);
+}
+
+static uint8_t lengthFor(uint16_t n) {
+  return n % 3 == 0 ? 7 : 4;
+}
+
+static bool isJournalSequenceByte(uint16_t addr) {
+  return addr >= CardLayout::JOURNAL_START &&
+         (addr - CardLayout::JOURNAL_START) % CardLayout::JOURNAL_ENTRY_SIZE == 4;
+}
+
+// Power lost just before the sequence byte of the commit made since the
+// snapshot: the record and head/tail bytes are in, the commit isn't
+static void dropLastCommit(const uint8_t* before) {
+  uint8_t* eeprom = NativeHAL::eepromData();
+  for (uint16_t addr = 0; addr <= E2END; addr++) {
+    if (isJournalSequenceByte(addr)) {
+      eeprom[addr] = before[addr];
+    }
+  }
+}
+
+static uint16_t readMagic() {
+  uint8_t* eeprom = NativeHAL::eepromData();
+  return (eeprom[EEPROM_MAGIC_ADDR] << 8) | eeprom[EEPROM_MAGIC_ADDR + 1];
+}
+
+void setUp() {
+  EEPROMQueue.flush();
+  NativeHAL::reset();
+  NativeHAL::eepromFill(0xFF);
+}
+
+void tearDown() {
+  EEPROMQueue.flush();
+}
+
+// ========== BASICS ==========
+
+void test_blank_eeprom_is_formatted() {
+  CardStore store;
+  store.begin();
+  EEPROMQueue.flush();
+  
+  TEST_ASSERT_EQUAL(0, store.count());
+  TEST_ASSERT_EQUAL_HEX16(EEPROM_MAGIC_NUMBER, readMagic());
+  TEST_ASSERT_EQUAL(0, store.garbageBytes());
+}
+
+void test_cards_survive_a_reboot() {
+  {
+    CardStore store;
+    store.begin();
+    TEST_ASSERT_TRUE(addCard(store, 1, 4));
+    TEST_ASSERT_TRUE(addCard(store, 2, 7));
+    TEST_ASSERT_FALSE(addCard(store, 1, 4));  // Already registered
+    EEPROMQueue.flush();
+  }
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(2, store.count());
+  TEST_ASSERT_TRUE(containsCard(store, 1, 4));
+  TEST_ASSERT_TRUE(containsCard(store, 2, 7));
+  TEST_ASSERT_FALSE(containsCard(store, 3, 4));
+  TEST_ASSERT_FALSE(containsCard(store, 1, 7));  // Same bytes, other length
+}
+
+void test_only_4_and_7_byte_uids_are_stored() {
+  CardStore store;
+  store.begin();
+  uint8_t uid[MAX_UID_LENGTH] = {1, 2, 3, 4, 5, 6, 7};
+  for (uint8_t length = 0; length <= MAX_UID_LENGTH; length++) {
+    TEST_ASSERT_EQUAL(length == 4 || length == 7, store.add(uid, length));
+  }
+  EEPROMQueue.flush();
+  
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(2, reloaded.count());
+}
+
+void test_store_fills_to_capacity() {
+  CardStore store;
+  store.begin();
+  for (uint16_t n = 0; n < MAX_STORED_CARDS; n++) {
+    TEST_ASSERT_TRUE(addCard(store, n, lengthFor(n)));
+  }
+  TEST_ASSERT_FALSE(addCard(store, MAX_STORED_CARDS, 4));
+  TEST_ASSERT_EQUAL(MAX_STORED_CARDS, store.count());
+  EEPROMQueue.flush();
+  
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(MAX_STORED_CARDS, reloaded.count());
+  for (uint16_t n = 0; n < MAX_STORED_CARDS; n++) {
+    TEST_ASSERT_TRUE(containsCard(reloaded, n, lengthFor(n)));
+  }
+}
+
+void test_card_at_lists_live_cards_oldest_first() {
+  CardStore store;
+  store.begin();
+  for (uint16_t n = 0; n < 4; n++) {
+    addCard(store, n, 4);
+  }
+  removeCard(store, 1, 4);
+  
+  uint8_t expected[MAX_UID_LENGTH];
+  StoredCard card;
+  uint16_t order[] = {0, 2, 3};
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(store.cardAt(i, card));
+    uidFor(order[i], 4, expected);
+    TEST_ASSERT_EQUAL(4, card.uidLength);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, card.uid, 4);
+  }
+  TEST_ASSERT_FALSE(store.cardAt(3, card));
+}
+
+// ========== TOMBSTONES AND COMPACTION ==========
+
+void test_remove_writes_a_single_byte() {
+  CardStore store;
+  store.begin();
+  addCard(store, 1, 7);
+  EEPROMQueue.flush();
+  
+  uint32_t writesBefore = NativeHAL::eepromTotalWrites();
+  TEST_ASSERT_TRUE(removeCard(store, 1, 7));
+  EEPROMQueue.flush();
+  TEST_ASSERT_EQUAL(1, NativeHAL::eepromTotalWrites() - writesBefore);
+  TEST_ASSERT_EQUAL(CardLayout::recordSize(7), store.garbageBytes());
+  TEST_ASSERT_FALSE(containsCard(store, 1, 7));
+  TEST_ASSERT_FALSE(removeCard(store, 1, 7));
+  
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(0, reloaded.count());
+  TEST_ASSERT_EQUAL(CardLayout::recordSize(7), reloaded.garbageBytes());
+}
+
+void test_compaction_reclaims_tombstones() {
+  CardStore store;
+  store.begin();
+  for (uint16_t n = 0; n < 20; n++) {
+    addCard(store, n, lengthFor(n));
+  }
+  for (uint16_t n = 0; n < 20; n += 2) {
+    removeCard(store, n, lengthFor(n));
+  }
+  uint16_t freeBefore = store.freeBytes();
+  TEST_ASSERT_GREATER_THAN(0, store.garbageBytes());
+  
+  uint8_t steps = 0;
+  while (store.compactStep()) {
+    TEST_ASSERT_LESS_THAN(100, ++steps);
+  }
+  TEST_ASSERT_EQUAL(0, store.garbageBytes());
+  TEST_ASSERT_GREATER_THAN(freeBefore, store.freeBytes());
+  EEPROMQueue.flush();
+  
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(10, reloaded.count());
+  TEST_ASSERT_EQUAL(0, reloaded.garbageBytes());
+  for (uint16_t n = 0; n < 20; n++) {
+    TEST_ASSERT_EQUAL(n % 2 == 1, containsCard(reloaded, n, lengthFor(n)));
+  }
+}
+
+// Register and revoke far more than the log holds, so it wraps repeatedly
+void test_log_wraps_around() {
+  CardStore store;
+  store.begin();
+  for (uint16_t n = 0; n < 10; n++) {
+    addCard(store, n, 7);
+  }
+  
+  uint32_t appended = 0;
+  for (uint16_t n = 100; appended < 3UL * CardLayout::LOG_SIZE; n++) {
+    TEST_ASSERT_TRUE(addCard(store, n, lengthFor(n)));
+    TEST_ASSERT_TRUE(removeCard(store, n, lengthFor(n)));
+    appended += CardLayout::recordSize(lengthFor(n));
+    if (store.needsCompaction()) {
+      store.compactStep();
+    }
+  }
+  EEPROMQueue.flush();
+  
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(10, reloaded.count());
+  for (uint16_t n = 0; n < 10; n++) {
+    TEST_ASSERT_TRUE(containsCard(reloaded, n, 7));
+  }
+  
+  // Wear is spread over the log instead of piling on the first records
+  TEST_ASSERT_LESS_OR_EQUAL(10, NativeHAL::eepromWriteCount(CardLayout::LOG_START));
+}
+
+// ========== JOURNAL RECOVERY ==========
+
+// The append must not have happened
+void test_torn_append_is_rolled_back() {
+  uint8_t before[E2END + 1];
+  {
+    CardStore store;
+    store.begin();
+    addCard(store, 1, 4);
+    addCard(store, 2, 7);
+    EEPROMQueue.flush();
+    memcpy(before, NativeHAL::eepromData(), sizeof(before));
+  
+    addCard(store, 3, 4);
+    EEPROMQueue.flush();
+  }
+  
+  dropLastCommit(before);
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(2, store.count());
+  TEST_ASSERT_TRUE(containsCard(store, 1, 4));
+  TEST_ASSERT_TRUE(containsCard(store, 2, 7));
+  TEST_ASSERT_FALSE(containsCard(store, 3, 4));
+  
+  // The half-written record is simply overwritten
+  TEST_ASSERT_TRUE(addCard(store, 4, 7));
+  EEPROMQueue.flush();
+  CardStore reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL(3, reloaded.count());
+  TEST_ASSERT_TRUE(containsCard(reloaded, 4, 7));
+}
+
+// A compaction step cut short leaves the moved record's original in place
+void test_torn_compaction_step_keeps_every_card() {
+  uint8_t before[E2END + 1];
+  {
+    CardStore store;
+    store.begin();
+    for (uint16_t n = 0; n < 6; n++) {
+      addCard(store, n, 4);
+    }
+    removeCard(store, 4, 4);
+    TEST_ASSERT_TRUE(store.compactStep());  // Moves card 0 to the tail
+    EEPROMQueue.flush();
+    memcpy(before, NativeHAL::eepromData(), sizeof(before));
+  
+    TEST_ASSERT_TRUE(store.compactStep());  // Moves card 1
+    EEPROMQueue.flush();
+  }
+  dropLastCommit(before);
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(5, store.count());
+  TEST_ASSERT_EQUAL(CardLayout::recordSize(4), store.garbageBytes());
+  for (uint16_t n = 0; n < 6; n++) {
+    TEST_ASSERT_EQUAL(n != 4, containsCard(store, n, 4));
+  }
+}
+
+void test_corrupt_journal_clears_cards() {
+  {
+    CardStore store;
+    store.begin();
+    addCard(store, 1, 4);
+    EEPROMQueue.flush();
+  }
+  
+  // Every entry points outside the log
+  uint8_t* eeprom = NativeHAL::eepromData();
+  for (uint16_t addr = CardLayout::JOURNAL_START; addr <= E2END; addr++) {
+    if (!isJournalSequenceByte(addr)) {
+      eeprom[addr] = 0xFF;
+    }
+  }
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(0, store.count());
+  TEST_ASSERT_TRUE(addCard(store, 2, 4));
+}
+
+// ========== OLDER LAYOUTS ==========
+
+// 0xABCD table: [length][active][uid x 7] per card after a count byte
+static void writeLegacyTable(const uint8_t* lengths, const uint8_t* active, uint8_t count) {
+  uint8_t* eeprom = NativeHAL::eepromData();
+  eeprom[EEPROM_MAGIC_ADDR] = EEPROM_LEGACY_MAGIC >> 8;
+  eeprom[EEPROM_MAGIC_ADDR + 1] = EEPROM_LEGACY_MAGIC & 0xFF;
+  eeprom[EEPROM_CARD_COUNT_ADDR] = count;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t* record = eeprom + CardLayout::LOG_START + i * CardLayout::LEGACY_RECORD_SIZE;
+    record[0] = lengths[i];
+    record[1] = active[i];
+    memset(record + 2, 0, MAX_UID_LENGTH);
+    uidFor(i, lengths[i] <= MAX_UID_LENGTH ? lengths[i] : MAX_UID_LENGTH, record + 2);
+  }
+}
+
+void test_legacy_table_is_migrated() {
+  // Corrupt lengths (0x14, 0x74 and 5) and an inactive slot are dropped
+  const uint8_t lengths[] = {4, 7, 0x14, 4, 0x74, 5, 7};
+  const uint8_t active[] = {1, 1, 1, 0, 1, 1, 1};
+  writeLegacyTable(lengths, active, sizeof(lengths));
+  {
+    CardStore store;
+    store.begin();
+    EEPROMQueue.flush();
+    TEST_ASSERT_EQUAL(3, store.count());
+    TEST_ASSERT_EQUAL_HEX16(EEPROM_MAGIC_NUMBER, readMagic());
+  }
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(3, store.count());
+  TEST_ASSERT_TRUE(containsCard(store, 0, 4));
+  TEST_ASSERT_TRUE(containsCard(store, 1, 7));
+  TEST_ASSERT_FALSE(containsCard(store, 3, 4));
+  TEST_ASSERT_TRUE(containsCard(store, 6, 7));
+  
+  // The old table's space is reused once the log wraps
+  for (uint16_t n = 100; n < 100 + MAX_STORED_CARDS - 3; n++) {
+    TEST_ASSERT_TRUE(addCard(store, n, 7));
+  }
+  TEST_ASSERT_EQUAL(MAX_STORED_CARDS, store.count());
+}
+
+// Reset at any point before the new magic: the migration runs again from
+// the untouched old table
+void test_interrupted_migration_is_redone() {
+  uint8_t lengths[CardLayout::LEGACY_MAX_CARDS];
+  uint8_t active[CardLayout::LEGACY_MAX_CARDS];
+  for (uint8_t i = 0; i < CardLayout::LEGACY_MAX_CARDS; i++) {
+    lengths[i] = lengthFor(i);
+    active[i] = 1;
+  }
+  
+  for (uint16_t cut = CardLayout::LEGACY_END; cut <= E2END; cut += 29) {
+    EEPROMQueue.flush();
+    NativeHAL::eepromFill(0xFF);
+    writeLegacyTable(lengths, active, CardLayout::LEGACY_MAX_CARDS);
+    {
+      CardStore store;
+      store.begin();
+      EEPROMQueue.flush();
+    }
+  
+    // Nothing from 'cut' on made it, and neither did the magic
+    uint8_t* eeprom = NativeHAL::eepromData();
+    memset(eeprom + cut, 0xFF, E2END + 1 - cut);
+    eeprom[EEPROM_MAGIC_ADDR + 1] = EEPROM_LEGACY_MAGIC & 0xFF;
+  
+    CardStore store;
+    store.begin();
+    TEST_ASSERT_EQUAL(CardLayout::LEGACY_MAX_CARDS, store.count());
+    for (uint8_t i = 0; i < CardLayout::LEGACY_MAX_CARDS; i++) {
+      TEST_ASSERT_TRUE(containsCard(store, i, lengthFor(i)));
+    }
+  }
+}
+
+// 0xABCE: packed records from LOG_START, card count in the header
+void test_packed_table_becomes_the_log() {
+  uint8_t* eeprom = NativeHAL::eepromData();
+  eeprom[EEPROM_MAGIC_ADDR] = EEPROM_PACKED_MAGIC >> 8;
+  eeprom[EEPROM_MAGIC_ADDR + 1] = EEPROM_PACKED_MAGIC & 0xFF;
+  eeprom[EEPROM_CARD_COUNT_ADDR] = 3;
+  uint16_t addr = CardLayout::LOG_START;
+  for (uint16_t n = 0; n < 3; n++) {
+    eeprom[addr] = CardLayout::header(lengthFor(n), true);
+    uidFor(n, lengthFor(n), eeprom + addr + 1);
+    addr += CardLayout::recordSize(lengthFor(n));
+  }
+  
+  CardStore store;
+  store.begin();
+  TEST_ASSERT_EQUAL(3, store.count());
+  for (uint16_t n = 0; n < 3; n++) {
+    TEST_ASSERT_TRUE(containsCard(store, n, lengthFor(n)));
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_eeprom_is_formatted);
+  RUN_TEST(test_cards_survive_a_reboot);
+  RUN_TEST(test_only_4_and_7_byte_uids_are_stored);
+  RUN_TEST(test_store_fills_to_capacity);
+  RUN_TEST(test_card_at_lists_live_cards_oldest_first);
+  RUN_TEST(test_remove_writes_a_single_byte);
+  RUN_TEST(test_compaction_reclaims_tombstones);
+  RUN_TEST(test_log_wraps_around);
+  RUN_TEST(test_torn_append_is_rolled_back);
+  RUN_TEST(test_torn_compaction_step_keeps_every_card);
+  RUN_TEST(test_corrupt_journal_clears_cards);
+  RUN_TEST(test_legacy_table_is_migrated);
+  RUN_TEST(test_interrupted_migration_is_redone);
+  RUN_TEST(test_packed_table_becomes_the_log);
+  return UNITY_END();
+}
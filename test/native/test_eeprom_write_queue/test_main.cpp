@@ -0,0 +1,160 @@
+// EEPROMWriteQueue against the host EEPROM and its EE_READY stand-in:
+// program order, skipped writes, reads of pending values and tickets.
+//   pio test -e native_test -f native/test_eeprom_write_queue
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <unity.h>
+#include "EEPROMWriteQueue.h"
+
+// Run the clock until the queue drains, noting each address as it is programmed
+static uint8_t drainInOrder(uint16_t* order, uint8_t maxWrites) {
+  uint8_t programmed = 0;
+  uint8_t before[E2END + 1];
+  while (!EEPROMQueue.idle()) {
+    memcpy(before, NativeHAL::eepromData(), sizeof(before));
+    uint32_t writes = NativeHAL::eepromTotalWrites();
+    NativeHAL::advanceMicros(10);
+    TEST_ASSERT_LESS_OR_EQUAL(writes + 1, NativeHAL::eepromTotalWrites());
+    if (NativeHAL::eepromTotalWrites() == writes) {
+      continue;
+    }
+    for (uint16_t addr = 0; addr <= E2END; addr++) {
+      if (before[addr] != NativeHAL::eepromData()[addr] && programmed < maxWrites) {
+        order[programmed++] = addr;
+      }
+    }
+  }
+  return programmed;
+}
+
+void setUp() {
+  EEPROMQueue.flush();
+  NativeHAL::reset();
+  NativeHAL::eepromFill(0xFF);
+}
+
+void tearDown() {
+  EEPROMQueue.flush();
+}
+
+void test_writes_are_programmed_in_the_background() {
+  EEPROMQueue.write(10, 0x12);
+  EEPROMQueue.write(11, 0x34);
+  TEST_ASSERT_FALSE(EEPROMQueue.idle());
+  TEST_ASSERT_EQUAL(0, NativeHAL::eepromTotalWrites());
+  
+  EEPROMQueue.flush();
+  TEST_ASSERT_TRUE(EEPROMQueue.idle());
+  TEST_ASSERT_EQUAL(2, NativeHAL::eepromTotalWrites());
+  TEST_ASSERT_EQUAL_HEX8(0x12, NativeHAL::eepromData()[10]);
+  TEST_ASSERT_EQUAL_HEX8(0x34, NativeHAL::eepromData()[11]);
+}
+
+void test_writes_complete_in_queue_order() {
+  const uint16_t addrs[] = {500, 20, 300, 21, 1000, 0};
+  for (uint8_t i = 0; i < 6; i++) {
+    EEPROMQueue.write(addrs[i], i);
+  }
+  
+  uint16_t order[8];
+  TEST_ASSERT_EQUAL(6, drainInOrder(order, 8));
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(addrs, order, 6);
+}
+
+// More writes than slots: write() waits for room, and what has been
+// programmed by then is always the oldest writes
+void test_full_queue_keeps_order() {
+  const uint8_t total = EEPROM_WRITE_QUEUE_SIZE * 2 + 3;
+  for (uint8_t i = 0; i < total; i++) {
+    EEPROMQueue.write(100 + i, i);
+    uint8_t programmed = 0;
+    while (programmed <= i && NativeHAL::eepromData()[100 + programmed] == programmed) {
+      programmed++;
+    }
+    TEST_ASSERT_EQUAL(programmed, NativeHAL::eepromTotalWrites());
+    TEST_ASSERT_LESS_OR_EQUAL(EEPROM_WRITE_QUEUE_SIZE, i + 1 - programmed);
+  }
+  EEPROMQueue.flush();
+  TEST_ASSERT_EQUAL(total, NativeHAL::eepromTotalWrites());
+}
+
+void test_unchanged_bytes_are_skipped() {
+  uint32_t queued = EEPROMQueue.writesQueued();
+  uint32_t skipped = EEPROMQueue.writesSkipped();
+  NativeHAL::eepromData()[40] = 0x55;
+  EEPROMQueue.write(40, 0x55);  // Already in EEPROM
+  TEST_ASSERT_TRUE(EEPROMQueue.idle());
+  
+  EEPROMQueue.write(41, 0x66);
+  EEPROMQueue.write(41, 0x66);  // Already queued
+  EEPROMQueue.flush();
+  
+  TEST_ASSERT_EQUAL(1, EEPROMQueue.writesQueued() - queued);
+  TEST_ASSERT_EQUAL(2, EEPROMQueue.writesSkipped() - skipped);
+  TEST_ASSERT_EQUAL(1, NativeHAL::eepromTotalWrites());
+}
+
+// A value matching an older pending write still goes out if a newer one differs
+void test_rewrite_to_older_value_is_kept() {
+  EEPROMQueue.write(60, 0x01);
+  EEPROMQueue.write(60, 0x02);
+  EEPROMQueue.write(60, 0x01);
+  EEPROMQueue.flush();
+  
+  TEST_ASSERT_EQUAL(3, NativeHAL::eepromTotalWrites());
+  TEST_ASSERT_EQUAL_HEX8(0x01, NativeHAL::eepromData()[60]);
+}
+
+void test_reads_see_pending_values() {
+  NativeHAL::eepromData()[70] = 0xA0;
+  EEPROMQueue.write(70, 0xA1);
+  EEPROMQueue.write(71, 0xB1);
+  EEPROMQueue.write(70, 0xA2);
+  
+  TEST_ASSERT_EQUAL_HEX8(0xA2, EEPROMQueue.read(70));
+  TEST_ASSERT_EQUAL_HEX8(0xB1, EEPROMQueue.read(71));
+  TEST_ASSERT_EQUAL_HEX8(0xFF, EEPROMQueue.read(72));
+  
+  // Still coherent part-way through the queue
+  NativeHAL::advanceMicros(NativeHAL::costs().eepromWriteMicros + 10);
+  TEST_ASSERT_FALSE(EEPROMQueue.idle());
+  TEST_ASSERT_EQUAL_HEX8(0xA2, EEPROMQueue.read(70));
+  TEST_ASSERT_EQUAL_HEX8(0xB1, EEPROMQueue.read(71));
+  
+  EEPROMQueue.flush();
+  TEST_ASSERT_EQUAL_HEX8(0xA2, EEPROMQueue.read(70));
+  TEST_ASSERT_EQUAL_HEX8(0xA2, NativeHAL::eepromData()[70]);
+}
+
+void test_ticket_completes_after_its_writes() {
+  TEST_ASSERT_TRUE(EEPROMQueue.isComplete(EEPROMQueue.ticket()));
+  
+  EEPROMQueue.write(80, 1);
+  uint16_t first = EEPROMQueue.ticket();
+  EEPROMQueue.write(81, 2);
+  EEPROMQueue.write(82, 3);
+  uint16_t last = EEPROMQueue.ticket();
+  TEST_ASSERT_FALSE(EEPROMQueue.isComplete(first));
+  
+  while (!EEPROMQueue.isComplete(first)) {
+    NativeHAL::advanceMicros(10);
+  }
+  TEST_ASSERT_EQUAL_HEX8(1, NativeHAL::eepromData()[80]);
+  TEST_ASSERT_FALSE(EEPROMQueue.isComplete(last));
+  
+  EEPROMQueue.flush();
+  TEST_ASSERT_TRUE(EEPROMQueue.isComplete(last));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_writes_are_programmed_in_the_background);
+  RUN_TEST(test_writes_complete_in_queue_order);
+  RUN_TEST(test_full_queue_keeps_order);
+  RUN_TEST(test_unchanged_bytes_are_skipped);
+  RUN_TEST(test_rewrite_to_older_value_is_kept);
+  RUN_TEST(test_reads_see_pending_values);
+  RUN_TEST(test_ticket_completes_after_its_writes);
+  return UNITY_END();
+}
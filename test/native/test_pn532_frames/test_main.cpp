@@ -0,0 +1,303 @@
+// PN532 frame handling over a scripted transport: command frames, ACKs,
+// checksums, frames longer than the buffer and timeouts.
+//   pio test -e native_test -f native/test_pn532_frames
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <unity.h>
+#include "PN532.h"
+
+static const uint8_t ACK[] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+// Hands out queued frames one readFrame() at a time and keeps the last
+// frame written
+class ScriptedTransport : public PN532Transport {
+public:
+  uint8_t written[PN532_BUFFER_SIZE];
+  uint8_t writtenLength;
+  uint8_t writes;
+
+  void begin() override {}
+  void wakeup() override {}
+  bool isReady() override { return _next < _count; }
+
+  void writeFrame(const uint8_t* frame, uint8_t length) override {
+    memcpy(written, frame, length);
+    writtenLength = length;
+    writes++;
+  }
+
+  // Like the bus, reads past the end of the frame return zeros
+  void readFrame(uint8_t* buffer, uint8_t length) override {
+    memset(buffer, 0, length);
+    if (_next < _count) {
+      memcpy(buffer, _frames[_next], min(length, _lengths[_next]));
+      _next++;
+    }
+  }
+
+  void queue(const uint8_t* frame, uint8_t length) {
+    memcpy(_frames[_count], frame, length);
+    _lengths[_count++] = length;
+  }
+
+  // [00][00][FF][LEN][LCS][D5][data...][DCS][00]
+  void queueResponse(const uint8_t* data, uint8_t length) {
+    uint8_t frame[64];
+    uint8_t sum = 0xD5;
+    frame[0] = 0x00;
+    frame[1] = 0x00;
+    frame[2] = 0xFF;
+    frame[3] = length + 1;
+    frame[4] = (uint8_t)(~(length + 1) + 1);
+    frame[5] = 0xD5;
+    for (uint8_t i = 0; i < length; i++) {
+      frame[6 + i] = data[i];
+      sum += data[i];
+    }
+    frame[6 + length] = (uint8_t)(~sum + 1);
+    frame[7 + length] = 0x00;
+    queue(frame, length + 8);
+  }
+
+  uint8_t* frame(uint8_t index) { return _frames[index]; }
+
+  void clear() {
+    _count = 0;
+    _next = 0;
+    writtenLength = 0;
+    writes = 0;
+  }
+
+private:
+  uint8_t _frames[4][64];
+  uint8_t _lengths[4];
+  uint8_t _count = 0;
+  uint8_t _next = 0;
+};
+
+static ScriptedTransport transport;
+
+static PN532Status pollUntilSettled(PN532& nfc) {
+  for (uint8_t i = 0; i < 10 && nfc.status() == PN532Status::BUSY; i++) {
+    nfc.poll();
+  }
+  return nfc.status();
+}
+
+static void startFirmwareVersion(PN532& nfc) {
+  uint8_t cmd = PN532_COMMAND_GETFIRMWAREVERSION;
+  nfc.startCommand(&cmd, 1, 4, 100);
+}
+
+void setUp() {
+  NativeHAL::reset();
+  transport.clear();
+}
+
+void tearDown() {
+}
+
+// ========== COMMAND FRAMES ==========
+
+void test_command_frame_layout() {
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  
+  const uint8_t expected[] = {0x00, 0x00, 0xFF, 0x02, 0xFE, 0xD4, 0x02, 0x2A, 0x00};
+  TEST_ASSERT_EQUAL(sizeof(expected), transport.writtenLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, transport.written, sizeof(expected));
+  TEST_ASSERT_TRUE(nfc.status() == PN532Status::BUSY);
+}
+
+void test_command_too_long_for_the_buffer_fails() {
+  PN532 nfc(transport);
+  uint8_t cmd[PN532_BUFFER_SIZE - PN532_FRAME_OVERHEAD + 1] = {PN532_COMMAND_INDATAEXCHANGE};
+  nfc.startCommand(cmd, sizeof(cmd), 0, 100);
+  
+  TEST_ASSERT_TRUE(nfc.status() == PN532Status::FAILED);
+  TEST_ASSERT_EQUAL(0, transport.writes);
+}
+
+// ========== ACK AND RESPONSE ==========
+
+void test_ack_then_response() {
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::BUSY);  // Nothing yet
+  
+  transport.queue(ACK, sizeof(ACK));
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::BUSY);  // ACK taken, response pending
+  
+  const uint8_t reply[] = {0x03, 0x32, 0x01, 0x06, 0x07};
+  transport.queueResponse(reply, sizeof(reply));
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::DONE);
+  TEST_ASSERT_EQUAL(4, nfc.responseLength());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(reply + 1, nfc.response(), 4);
+}
+
+void test_nack_fails_the_command() {
+  const uint8_t nack[] = {0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00};
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  transport.queue(nack, sizeof(nack));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+void test_response_without_preamble() {
+  const uint8_t frame[] = {0x00, 0xFF, 0x03, 0xFD, 0xD5, 0x15, 0xAA, 0x6C, 0x00};
+  PN532 nfc(transport);
+  uint8_t cmd = PN532_COMMAND_SAMCONFIGURATION;
+  nfc.startCommand(&cmd, 1, 1, 100);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queue(frame, sizeof(frame));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::DONE);
+  TEST_ASSERT_EQUAL(1, nfc.responseLength());
+  TEST_ASSERT_EQUAL_HEX8(0xAA, nfc.response()[0]);
+}
+
+// ========== BAD FRAMES ==========
+
+void test_bad_length_checksum_fails() {
+  const uint8_t frame[] = {0x00, 0x00, 0xFF, 0x03, 0xFC, 0xD5, 0x15, 0xAA, 0x6C, 0x00};
+  PN532 nfc(transport);
+  uint8_t cmd = PN532_COMMAND_SAMCONFIGURATION;
+  nfc.startCommand(&cmd, 1, 1, 100);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queue(frame, sizeof(frame));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+void test_bad_data_checksum_fails() {
+  const uint8_t frame[] = {0x00, 0x00, 0xFF, 0x03, 0xFD, 0xD5, 0x15, 0xAA, 0x6D, 0x00};
+  PN532 nfc(transport);
+  uint8_t cmd = PN532_COMMAND_SAMCONFIGURATION;
+  nfc.startCommand(&cmd, 1, 1, 100);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queue(frame, sizeof(frame));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+void test_reply_to_another_command_fails() {
+  const uint8_t reply[] = {0x4B, 0x00};  // InListPassiveTarget's reply code
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queueResponse(reply, sizeof(reply));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+void test_error_frame_fails() {
+  const uint8_t frame[] = {0x00, 0x00, 0xFF, 0x01, 0xFF, 0x7F, 0x81, 0x00};
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queue(frame, sizeof(frame));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+// ========== FRAMES LONGER THAN THE BUFFER ==========
+
+// Anything but a target list has to fit what was asked for
+void test_oversized_response_fails() {
+  uint8_t reply[PN532_BUFFER_SIZE] = {PN532_COMMAND_GETFIRMWAREVERSION + 1};
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queueResponse(reply, sizeof(reply));
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+// A DESFire-style target: 7-byte UID and a 20-byte ATS run past the buffer
+void test_target_list_with_long_ats_is_kept() {
+  uint8_t reply[] = {
+    PN532_COMMAND_INLISTPASSIVETARGET + 1, 0x01, 0x01, 0x03, 0x44, 0x20, 0x07,
+    0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+    0x14, 0x75, 0x77, 0x81, 0x02, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+  };
+  PN532 nfc(transport);
+  nfc.startListPassiveTarget(100);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queueResponse(reply, sizeof(reply));
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::DONE);
+  
+  uint8_t uid[7];
+  uint8_t uidLength = 0;
+  uint8_t sak = 0;
+  TEST_ASSERT_TRUE(nfc.readPassiveTarget(uid, &uidLength, nullptr, &sak));
+  TEST_ASSERT_EQUAL(7, uidLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(reply + 7, uid, 7);
+  TEST_ASSERT_EQUAL_HEX8(0x20, sak);
+}
+
+// With the checksum cut off, the length checksum still guards the frame
+void test_truncated_target_list_checks_lcs() {
+  uint8_t reply[PN532_BUFFER_SIZE] = {PN532_COMMAND_INLISTPASSIVETARGET + 1, 0x01, 0x01, 0x00, 0x04, 0x08, 0x04};
+  PN532 nfc(transport);
+  nfc.startListPassiveTarget(100);
+  transport.queue(ACK, sizeof(ACK));
+  transport.queueResponse(reply, sizeof(reply));
+  transport.frame(1)[4]++;  // LCS
+  
+  TEST_ASSERT_TRUE(pollUntilSettled(nfc) == PN532Status::FAILED);
+}
+
+// ========== TIMEOUTS ==========
+
+void test_silent_pn532_times_out() {
+  PN532 nfc(transport);
+  startFirmwareVersion(nfc);
+  transport.queue(ACK, sizeof(ACK));
+  nfc.poll();
+  uint8_t writes = transport.writes;
+  
+  NativeHAL::advanceMicros(99000);
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::BUSY);
+  NativeHAL::advanceMicros(1000);
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::FAILED);
+  
+  // The PN532 is told to drop the command
+  TEST_ASSERT_EQUAL(writes + 1, transport.writes);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ACK, transport.written, sizeof(ACK));
+}
+
+// Timeout 0 means no limit for poll(), but a blocking call still gives up
+void test_blocking_call_without_timeout_is_capped() {
+  PN532 nfc(transport);
+  nfc.startListPassiveTarget(0);
+  NativeHAL::advanceMicros(5000000UL);
+  TEST_ASSERT_TRUE(nfc.poll() == PN532Status::BUSY);
+  
+  uint8_t cmd = PN532_COMMAND_GETFIRMWAREVERSION;
+  unsigned long startedAt = millis();
+  TEST_ASSERT_FALSE(nfc.command(&cmd, 1, 4, 0));
+  unsigned long waited = millis() - startedAt;
+  TEST_ASSERT_GREATER_OR_EQUAL(PN532_BLOCKING_TIMEOUT, waited);
+  TEST_ASSERT_LESS_THAN(PN532_BLOCKING_TIMEOUT + 20, waited);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_command_frame_layout);
+  RUN_TEST(test_command_too_long_for_the_buffer_fails);
+  RUN_TEST(test_ack_then_response);
+  RUN_TEST(test_nack_fails_the_command);
+  RUN_TEST(test_response_without_preamble);
+  RUN_TEST(test_bad_length_checksum_fails);
+  RUN_TEST(test_bad_data_checksum_fails);
+  RUN_TEST(test_reply_to_another_command_fails);
+  RUN_TEST(test_error_frame_fails);
+  RUN_TEST(test_oversized_response_fails);
+  RUN_TEST(test_target_list_with_long_ats_is_kept);
+  RUN_TEST(test_truncated_target_list_checks_lcs);
+  RUN_TEST(test_silent_pn532_times_out);
+  RUN_TEST(test_blocking_call_without_timeout_is_capped);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+// Split-phase NFCReader::readCard() against the PN532 emulator: one PN532
+// command per call, UID-first reporting, the custom sector cache and
+// GET_VERSION identification.
+//   pio test -e native_test -f native/test_read_state_machine
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <NativePN532.h>
+#include <unity.h>
+#include "Config.h"
+#include "NFCReader.h"
+
+static const uint8_t CLASSIC_UID[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static const uint8_t CLONED_UID[4] = {0x11, 0x22, 0x33, 0x44};
+static const uint8_t NTAG_UID[7] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x80};
+
+static uint16_t callsMade;
+
+static NativeCard clonedClassic() {
+  NativeCard card = NativeCard::classic1K(CLASSIC_UID);
+  card.memory[64] = CARD_MAGIC_BYTE1;
+  card.memory[65] = CARD_MAGIC_BYTE2;
+  card.memory[66] = sizeof(CLONED_UID);
+  memcpy(&card.memory[67], CLONED_UID, sizeof(CLONED_UID));
+  return card;
+}
+
+// One readCard() call: never more than one PN532 command, and well under
+// the 2.5 ms or more any card operation takes, so it never waits on one
+static NFCCardInfo step(NFCReader& reader, bool reportUIDFirst) {
+  uint32_t commands = NativePN532::module().commands;
+  uint64_t startedAt = NativeHAL::nowMicros();
+  NFCCardInfo info = reader.readCard(reportUIDFirst);
+  TEST_ASSERT_LESS_OR_EQUAL(commands + 1, NativePN532::module().commands);
+  TEST_ASSERT_LESS_THAN(1000, (uint32_t)(NativeHAL::nowMicros() - startedAt));
+  NativeHAL::advanceMicros(100);
+  callsMade++;
+  return info;
+}
+
+static NFCCardInfo stepUntilDetected(NFCReader& reader, bool reportUIDFirst) {
+  for (uint16_t i = 0; i < 5000; i++) {
+    NFCCardInfo info = step(reader, reportUIDFirst);
+    if (info.detected) {
+      return info;
+    }
+  }
+  TEST_FAIL_MESSAGE("No card reported");
+  return NFCCardInfo();
+}
+
+// Runs the read in flight to its end; false if it reported a card
+static bool stepUntilIdle(NFCReader& reader, bool reportUIDFirst) {
+  for (uint16_t i = 0; i < 5000 && reader.isReadInProgress(); i++) {
+    if (step(reader, reportUIDFirst).detected) {
+      return false;
+    }
+  }
+  return !reader.isReadInProgress();
+}
+
+// Take the card away long enough to count as removed, then tap again
+static void tapAgain(NFCReader& reader, const NativeCard& card) {
+  NativePN532::module().remove();
+  stepUntilIdle(reader, false);
+  reader.resetCardState();
+  NativeHAL::advanceMicros(100000);
+  NativePN532::module().present(card);
+}
+
+// Hardware SPI, so a call's time is its own work rather than bit-banging
+static void beginReader(NFCReader& reader) {
+  reader.setSPIClock(PN532_SPI_MAX_CLOCK);
+  TEST_ASSERT_TRUE(reader.begin());
+  reader.clearSectorCache();
+  NativeHAL::advanceMicros(NFC_POLL_SLOW_INTERVAL * 1000UL);
+}
+
+void setUp() {
+  NativeHAL::reset();
+  NativePN532::module().reset();
+  NativePN532::module().setIrqPin(NFC_IRQ);
+  NativePN532::module().attachSPI(NFC_SCK, NFC_MISO, NFC_MOSI, NFC_SS);
+  callsMade = 0;
+}
+
+void tearDown() {
+}
+
+// ========== CLASSIC CARDS ==========
+
+void test_classic_read_in_one_pass() {
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(clonedClassic());
+  
+  NFCCardInfo info = stepUntilDetected(reader, false);
+  TEST_ASSERT_FALSE(info.sectorPending);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLASSIC_UID, info.uid, 4);
+  TEST_ASSERT_TRUE(info.cardType == NFCCardType::MIFARE_CLASSIC_1K);
+  TEST_ASSERT_TRUE(info.hasClonedUID);
+  TEST_ASSERT_EQUAL(4, info.clonedUIDLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLONED_UID, info.clonedUID, 4);
+  TEST_ASSERT_EQUAL(1, NativePN532::module().authentications);
+  TEST_ASSERT_FALSE(reader.isReadInProgress());
+  
+  // List, authenticate, read: a handful of calls each, not one long one
+  TEST_ASSERT_GREATER_OR_EQUAL(6, callsMade);
+}
+
+void test_uid_is_reported_before_the_sector() {
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(clonedClassic());
+  
+  NFCCardInfo first = stepUntilDetected(reader, true);
+  TEST_ASSERT_TRUE(first.sectorPending);
+  TEST_ASSERT_FALSE(first.hasClonedUID);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLASSIC_UID, first.uid, 4);
+  TEST_ASSERT_EQUAL(0, NativePN532::module().authentications);
+  TEST_ASSERT_TRUE(reader.isReadInProgress());
+  
+  NFCCardInfo second = stepUntilDetected(reader, true);
+  TEST_ASSERT_FALSE(second.sectorPending);
+  TEST_ASSERT_TRUE(second.hasClonedUID);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLASSIC_UID, second.uid, 4);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLONED_UID, second.clonedUID, 4);
+  TEST_ASSERT_EQUAL(1, NativePN532::module().authentications);
+  TEST_ASSERT_FALSE(reader.isReadInProgress());
+}
+
+void test_second_tap_comes_from_the_cache() {
+  NativeCard card = clonedClassic();
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(card);
+  stepUntilDetected(reader, true);
+  stepUntilDetected(reader, true);
+  TEST_ASSERT_EQUAL(1, reader.getSectorCacheMisses());
+  
+  tapAgain(reader, card);
+  NFCCardInfo info = stepUntilDetected(reader, true);
+  TEST_ASSERT_FALSE(info.sectorPending);
+  TEST_ASSERT_TRUE(info.hasClonedUID);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(CLONED_UID, info.clonedUID, 4);
+  TEST_ASSERT_EQUAL(1, reader.getSectorCacheHits());
+  TEST_ASSERT_EQUAL(1, NativePN532::module().authentications);
+  TEST_ASSERT_FALSE(reader.isReadInProgress());
+}
+
+// A fast grant on the physical UID: the sector is still read for the
+// cache, without a second report
+void test_skipped_sector_still_fills_the_cache() {
+  NativeCard card = clonedClassic();
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(card);
+  
+  TEST_ASSERT_TRUE(stepUntilDetected(reader, true).sectorPending);
+  reader.skipCustomSector();
+  TEST_ASSERT_TRUE(stepUntilIdle(reader, true));
+  TEST_ASSERT_EQUAL(1, NativePN532::module().authentications);
+  
+  tapAgain(reader, card);
+  NFCCardInfo info = stepUntilDetected(reader, true);
+  TEST_ASSERT_FALSE(info.sectorPending);
+  TEST_ASSERT_TRUE(info.hasClonedUID);
+  TEST_ASSERT_EQUAL(1, reader.getSectorCacheHits());
+  TEST_ASSERT_EQUAL(1, NativePN532::module().authentications);
+}
+
+// Card pulled between the UID and the sector: reported without a cloned
+// UID, and nothing is cached for it
+void test_card_removed_mid_read() {
+  NativeCard card = clonedClassic();
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(card);
+  
+  TEST_ASSERT_TRUE(stepUntilDetected(reader, true).sectorPending);
+  NativePN532::module().remove();
+  NFCCardInfo info = stepUntilDetected(reader, true);
+  TEST_ASSERT_FALSE(info.sectorPending);
+  TEST_ASSERT_FALSE(info.hasClonedUID);
+  TEST_ASSERT_FALSE(reader.isReadInProgress());
+  
+  tapAgain(reader, card);
+  TEST_ASSERT_TRUE(stepUntilDetected(reader, true).sectorPending);
+  TEST_ASSERT_EQUAL(0, reader.getSectorCacheHits());
+}
+
+// ========== PAGE TAGS ==========
+
+void test_ultralight_is_identified_without_authentication() {
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(NativeCard::ultralight(NTAG_UID));
+  
+  NFCCardInfo info = stepUntilDetected(reader, true);
+  TEST_ASSERT_FALSE(info.sectorPending);
+  TEST_ASSERT_EQUAL(7, info.uidLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(NTAG_UID, info.uid, 7);
+  TEST_ASSERT_TRUE(info.cardType == NFCCardType::MIFARE_ULTRALIGHT);
+  TEST_ASSERT_EQUAL(0, NativePN532::module().authentications);
+  TEST_ASSERT_FALSE(reader.isReadInProgress());
+}
+
+void test_ntag_is_told_apart_by_get_version() {
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  NativePN532::module().present(NativeCard::ntag215(NTAG_UID));
+  
+  NFCCardInfo info = stepUntilDetected(reader, false);
+  TEST_ASSERT_TRUE(info.cardType == NFCCardType::NTAG);
+  TEST_ASSERT_EQUAL_HEX8(0x11, info.storageSize);  // NTAG215
+  TEST_ASSERT_EQUAL(0, NativePN532::module().authentications);
+}
+
+// ========== NO CARD ==========
+
+void test_empty_field_reports_nothing() {
+  NFCReader reader(NFCCommMode::SPI, NFCReadMode::POLLING);
+  beginReader(reader);
+  
+  for (uint16_t i = 0; i < 2000; i++) {
+    TEST_ASSERT_FALSE(step(reader, true).detected);
+  }
+  TEST_ASSERT_EQUAL(0, NativePN532::module().authentications);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_classic_read_in_one_pass);
+  RUN_TEST(test_uid_is_reported_before_the_sector);
+  RUN_TEST(test_second_tap_comes_from_the_cache);
+  RUN_TEST(test_skipped_sector_still_fills_the_cache);
+  RUN_TEST(test_card_removed_mid_read);
+  RUN_TEST(test_ultralight_is_identified_without_authentication);
+  RUN_TEST(test_ntag_is_told_apart_by_get_version);
+  RUN_TEST(test_empty_field_reports_nothing);
+  return UNITY_END();
+}